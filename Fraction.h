@@ -5,6 +5,7 @@
 #include <cryptopp/integer.h>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 namespace AlgebraTAU
 {
@@ -12,6 +13,20 @@ class Fraction
 {
     CryptoPP::Integer a, b;
 
+    // scratch integers of the calling thread, fix() divides into them and swaps the quotients in,
+    // so the limbs are recycled between operations instead of being allocated for every division
+    // (the limbs of an Integer come from CryptoPP's own allocator, which can't be replaced)
+    struct scratch
+    {
+        CryptoPP::Integer quotient, remainder;
+    };
+
+    static scratch& local_scratch()
+    {
+        static thread_local scratch s;
+        return s;
+    }
+
     void fix()
     {
         if (b.IsNegative())
@@ -19,14 +34,21 @@ class Fraction
             a.Negate();
             b.Negate();
         }
+        ++gcd_calls();
         CryptoPP::Integer d = CryptoPP::Integer::Gcd(a.AbsoluteValue(), b);
-        a /= d;
-        b /= d;
+        // most results are already reduced
+        if (d.IsUnit()) return;
+        scratch& s = local_scratch();
+        CryptoPP::Integer::Divide(s.remainder, s.quotient, a, d);
+        a.swap(s.quotient);
+        CryptoPP::Integer::Divide(s.remainder, s.quotient, b, d);
+        b.swap(s.quotient);
     }
 
     public:
     Fraction(const int64_t& a, const int64_t& b = 1) : a(a), b(b)
     {
+        fix();
     }
 
     Fraction(const CryptoPP::Integer& a = 0, const CryptoPP::Integer& b = 1) : a(a), b(b)
@@ -34,19 +56,25 @@ class Fraction
         fix();
     }
 
+    // every constructed fraction is already reduced, so copies don't reduce again
     Fraction(const Fraction& o) : a(o.a), b(o.b)
     {
-        fix();
     }
 
     Fraction& operator=(const Fraction& o)
     {
         a = o.a;
         b = o.b;
-        fix();
         return *this;
     }
 
+    // swaps the integers rather than copying them
+    void swap(Fraction& o)
+    {
+        a.swap(o.a);
+        b.swap(o.b);
+    }
+
     Fraction& operator*=(const Fraction& o)
     {
         a *= o.a;
@@ -123,8 +151,47 @@ class Fraction
     }
 
     CryptoPP::Integer round() const;
+
+    const CryptoPP::Integer& numerator() const
+    {
+        return a;
+    }
+
+    const CryptoPP::Integer& denominator() const
+    {
+        return b;
+    }
+
+    // returns the number of bits of the larger of the numerator and the denominator
+    size_t bit_length() const
+    {
+        return std::max(a.BitCount(), b.BitCount());
+    }
+
+    // returns an approximation of log2(*this)
+    double log2() const;
+
+    // counts the gcd computations preformed by the current thread, for instrumentation
+    static size_t& gcd_calls()
+    {
+        static thread_local size_t counter = 0;
+        return counter;
+    }
 };
 
+// the sums of blocks of strassen-winograd have larger denominators than the entries, which makes
+// their products more expensive, so the recursion pays off only for large blocks
+template <>
+struct strassen_crossover<Fraction>
+{
+    static const size_t value = 64;
+};
+
+void swap(Fraction& f1, Fraction& f2)
+{
+    f1.swap(f2);
+}
+
 Fraction operator*(const Fraction& f1, const Fraction& f2)
 {
     Fraction res = f1;
@@ -165,7 +232,7 @@ bool operator>(const Fraction& f1, const Fraction& f2)
 
 bool operator<=(const Fraction& f1, const Fraction& f2)
 {
-    return !(f2 > f1);
+    return !(f1 > f2);
 }
 
 bool operator>=(const Fraction& f1, const Fraction& f2)
@@ -200,6 +267,74 @@ CryptoPP::Integer round(const Fraction& f)
     return f.round();
 }
 
+// writes x as a sign byte, a 32 bit length and the big endian bytes of |x|
+void write_binary(std::ostream& os, const CryptoPP::Integer& x)
+{
+    uint32_t size = x.MinEncodedSize();
+    std::vector<CryptoPP::byte> bytes(size);
+    x.AbsoluteValue().Encode(bytes.data(), size);
+    write_binary(os, uint8_t(x.IsNegative()));
+    write_binary(os, size);
+    os.write(reinterpret_cast<const char*>(bytes.data()), size);
+}
+
+void read_binary(std::istream& is, CryptoPP::Integer& x)
+{
+    uint8_t negative = 0;
+    uint32_t size = 0;
+    read_binary(is, negative);
+    read_binary(is, size);
+    if (!is) return;
+    std::vector<CryptoPP::byte> bytes(size);
+    is.read(reinterpret_cast<char*>(bytes.data()), size);
+    x.Decode(bytes.data(), size);
+    if (negative) x.Negate();
+}
+
+void write_binary(std::ostream& os, const Fraction& f)
+{
+    write_binary(os, f.numerator());
+    write_binary(os, f.denominator());
+}
+
+void read_binary(std::istream& is, Fraction& f)
+{
+    CryptoPP::Integer a, b;
+    read_binary(is, a);
+    read_binary(is, b);
+    if (is) f = Fraction(a, b);
+}
+
+size_t bit_length(const Fraction& f)
+{
+    return f.bit_length();
+}
+
+size_t gcd_calls(const Fraction&)
+{
+    return Fraction::gcd_calls();
+}
+
+double log2(const Fraction& f)
+{
+    return f.log2();
+}
+
+// returns an approximation of log2(|x|) using the 53 most significant bits of x
+double log2(const CryptoPP::Integer& x)
+{
+    unsigned int bits = x.BitCount();
+    if (bits == 0) return -HUGE_VAL;
+    unsigned int shift = bits > 53 ? bits - 53 : 0;
+    return std::log2(double((x.AbsoluteValue() >> shift).ConvertToLong())) + shift;
+}
+
+double Fraction::log2() const
+{
+    if (IsNegative()) return NAN;
+    return AlgebraTAU::log2(a) - AlgebraTAU::log2(b);
+}
+
 CryptoPP::Integer Fraction::round() const
 {
     CryptoPP::Integer res = a / b;
@@ -0,0 +1,297 @@
+#include "Fraction.h"
+#include "matrix.h"
+#include "server.h"
+#include "vector.h"
+
+#include <benchmark/benchmark.h>
+#include <random>
+
+// run with --benchmark_out=FILE --benchmark_out_format=json to get machine readable results
+// (the benchmark_json target does so), all the inputs are generated from fixed seeds
+
+using AlgebraTAU::Fraction;
+using AlgebraTAU::matrix;
+using CryptoPP::Integer;
+
+namespace
+{
+
+// a fraction whose numerator and denominator have up to bits bits
+Fraction random_fraction(CryptoPP::RandomNumberGenerator& rng, size_t bits)
+{
+    Integer a, b;
+    a.Randomize(rng, bits);
+    b.Randomize(rng, bits);
+    return Fraction(a, b + 1);
+}
+
+// a square matrix with entries uniform in [-1, 1]
+matrix<double> random_double_matrix(size_t n, uint64_t seed)
+{
+    std::mt19937_64 engine(seed);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    matrix<double> res(n, n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            res(i, j) = dist(engine);
+    return res;
+}
+
+// a square matrix of fractions with numerators and denominators of up to bits bits
+matrix<Fraction> random_fraction_matrix(size_t n, size_t bits, uint64_t seed)
+{
+    SeededRng rng(seed);
+    matrix<Fraction> res(n, n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            res(i, j) = random_fraction(rng, bits);
+    return res;
+}
+
+// a square matrix of integers of up to bits bits
+matrix<Integer> random_integer_matrix(size_t n, size_t bits, uint64_t seed)
+{
+    SeededRng rng(seed);
+    matrix<Integer> res(n, n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            res(i, j).Randomize(rng, bits);
+    return res;
+}
+
+// a square integer basis with entries uniform in [-100, 100], full rank with high probability
+matrix<Fraction> random_basis(size_t n, uint64_t seed)
+{
+    std::mt19937_64 engine(seed);
+    std::uniform_int_distribution<int64_t> dist(-100, 100);
+    matrix<Fraction> res(n, n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            res(i, j) = dist(engine);
+    return res;
+}
+
+// the knapsack (subset sum) lattice of n weights of bits bits: row i is (e_i, a_i)
+matrix<Fraction> knapsack_basis(size_t n, size_t bits, uint64_t seed)
+{
+    SeededRng rng(seed);
+    matrix<Fraction> res(n, n + 1, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        Integer a;
+        a.Randomize(rng, bits);
+        res(i, i) = 1;
+        res(i, n) = a;
+    }
+    return res;
+}
+
+void BM_FractionAdd(benchmark::State& state)
+{
+    SeededRng rng(1);
+    Fraction a = random_fraction(rng, state.range(0)), b = random_fraction(rng, state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a + b);
+}
+BENCHMARK(BM_FractionAdd)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+void BM_FractionMultiply(benchmark::State& state)
+{
+    SeededRng rng(2);
+    Fraction a = random_fraction(rng, state.range(0)), b = random_fraction(rng, state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a * b);
+}
+BENCHMARK(BM_FractionMultiply)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+void BM_FractionDivide(benchmark::State& state)
+{
+    SeededRng rng(3);
+    Fraction a = random_fraction(rng, state.range(0)), b = random_fraction(rng, state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a / b);
+}
+BENCHMARK(BM_FractionDivide)->Arg(64)->Arg(256)->Arg(1024)->Arg(4096);
+
+void BM_MatrixMultiplyDouble(benchmark::State& state)
+{
+    matrix<double> a = random_double_matrix(state.range(0), 4), b = random_double_matrix(state.range(0), 5);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a * b);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_MatrixMultiplyDouble)->RangeMultiplier(2)->Range(16, 256)->Complexity(benchmark::oNCubed);
+
+void BM_MatrixMultiplyFraction(benchmark::State& state)
+{
+    matrix<Fraction> a = random_fraction_matrix(state.range(0), 32, 6),
+                     b = random_fraction_matrix(state.range(0), 32, 7);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a * b);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_MatrixMultiplyFraction)->RangeMultiplier(2)->Range(4, 32)->Complexity(benchmark::oNCubed);
+
+// from 32 on the products are computed by strassen-winograd recursion
+void BM_MatrixMultiplyInteger(benchmark::State& state)
+{
+    matrix<Integer> a = random_integer_matrix(state.range(0), 4096, 8),
+                    b = random_integer_matrix(state.range(0), 4096, 9);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a * b);
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_MatrixMultiplyInteger)->RangeMultiplier(2)->Range(8, 64)->Unit(benchmark::kMillisecond)->Complexity();
+
+void BM_DetDouble(benchmark::State& state)
+{
+    matrix<double> a = random_double_matrix(state.range(0), 8);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.det());
+}
+BENCHMARK(BM_DetDouble)->RangeMultiplier(2)->Range(16, 256);
+
+void BM_DetFraction(benchmark::State& state)
+{
+    matrix<Fraction> a = random_fraction_matrix(state.range(0), 32, 9);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.det());
+}
+BENCHMARK(BM_DetFraction)->RangeMultiplier(2)->Range(4, 16);
+
+void BM_TransposeDouble(benchmark::State& state)
+{
+    matrix<double> a = random_double_matrix(state.range(0), 10);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.transpose());
+    state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(0) * sizeof(double));
+}
+BENCHMARK(BM_TransposeDouble)->RangeMultiplier(4)->Range(64, 2048);
+
+void BM_TransposeInPlaceDouble(benchmark::State& state)
+{
+    matrix<double> a = random_double_matrix(state.range(0), 10);
+    for (auto _ : state)
+    {
+        a.transpose_in_place();
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * state.range(0) * sizeof(double));
+}
+BENCHMARK(BM_TransposeInPlaceDouble)->RangeMultiplier(4)->Range(64, 2048);
+
+void BM_TransposeFraction(benchmark::State& state)
+{
+    matrix<Fraction> a = random_fraction_matrix(state.range(0), 32, 10);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a.transpose());
+}
+BENCHMARK(BM_TransposeFraction)->RangeMultiplier(4)->Range(16, 256);
+
+void BM_GaussianEliminationDouble(benchmark::State& state)
+{
+    matrix<double> a = random_double_matrix(state.range(0), 11);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        matrix<double> m = a;
+        state.ResumeTiming();
+        AlgebraTAU::gaussian_elimination(m);
+        benchmark::DoNotOptimize(m(0, 0));
+    }
+}
+BENCHMARK(BM_GaussianEliminationDouble)->RangeMultiplier(2)->Range(16, 256);
+
+void BM_GaussianEliminationFraction(benchmark::State& state)
+{
+    matrix<Fraction> a = random_fraction_matrix(state.range(0), 32, 12);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        matrix<Fraction> m = a;
+        state.ResumeTiming();
+        AlgebraTAU::gaussian_elimination(m);
+        benchmark::DoNotOptimize(m(0, 0));
+    }
+}
+BENCHMARK(BM_GaussianEliminationFraction)->RangeMultiplier(2)->Range(4, 16);
+
+void BM_GramSchmidtFraction(benchmark::State& state)
+{
+    matrix<Fraction> a = random_basis(state.range(0), 13);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        matrix<Fraction> m = a;
+        state.ResumeTiming();
+        AlgebraTAU::gram_schmidt(m);
+        benchmark::DoNotOptimize(m(0, 0));
+    }
+}
+BENCHMARK(BM_GramSchmidtFraction)->RangeMultiplier(2)->Range(4, 16);
+
+void BM_LLLRandom(benchmark::State& state)
+{
+    matrix<Fraction> a = random_basis(state.range(0), 14);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        matrix<Fraction> m = a;
+        state.ResumeTiming();
+        AlgebraTAU::LLL(m, Fraction(3, 4));
+        benchmark::DoNotOptimize(m(0, 0));
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_LLLRandom)->DenseRange(4, 16, 4)->Unit(benchmark::kMillisecond)->Complexity();
+
+void BM_LLLKnapsack(benchmark::State& state)
+{
+    matrix<Fraction> a = knapsack_basis(state.range(0), 32, 15);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        matrix<Fraction> m = a;
+        state.ResumeTiming();
+        AlgebraTAU::LLL(m, Fraction(3, 4));
+        benchmark::DoNotOptimize(m(0, 0));
+    }
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_LLLKnapsack)->DenseRange(4, 16, 4)->Unit(benchmark::kMillisecond)->Complexity();
+
+// oracle calls of the attack's fast local oracle, items per second is the calls per second
+void BM_OracleCalls(benchmark::State& state)
+{
+    SeededRng rng(16);
+    Server srv(state.range(0), rng);
+    Integer c = srv.pkcs_encrypt("benchmark", rng), s;
+    Server::Oracle oracle(srv, c);
+    for (auto _ : state)
+    {
+        s.Randomize(rng, 2, srv.publicKey.GetModulus() / 2);
+        benchmark::DoNotOptimize(oracle.is_good_pivot(s));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OracleCalls)->Arg(1024)->Arg(2048);
+
+// the blinded reference path of Server::is_pkcs_conforming, for comparison with BM_OracleCalls
+void BM_OracleCallsReference(benchmark::State& state)
+{
+    SeededRng rng(17);
+    Server srv(state.range(0), rng);
+    Integer c = srv.pkcs_encrypt("benchmark", rng), s;
+    const Integer& n = srv.publicKey.GetModulus();
+    for (auto _ : state)
+    {
+        s.Randomize(rng, 2, n / 2);
+        benchmark::DoNotOptimize(srv.is_pkcs_conforming(srv.publicKey.ApplyFunction(s).Times(c).Modulo(n)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OracleCallsReference)->Arg(1024)->Arg(2048);
+
+} // namespace
+
+BENCHMARK_MAIN();
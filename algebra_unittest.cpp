@@ -1,10 +1,18 @@
 #include "Fraction.h"
+#include "linear_system.h"
 #include "matrix.h"
+#include "modint.h"
+#include "normal_form.h"
 #include "vector.h"
 
+#define BLEICHENBACHER_ATTACK_NO_MAIN
+#include "bleichenbacher_attack.cpp"
+
 #include <cmath>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <random>
+#include <thread>
 
 #define epsilon 1e-12
 
@@ -56,6 +64,55 @@ TEST(MatrixOperators, MatrixMultiplication)
     EXPECT_EQ(M1 * M2, res);
 }
 
+TEST(MatrixOperators, RvalueOperators)
+{
+    AlgebraTAU::matrix<double> M1({ { 0, 1, 2 }, { 3, 4, 5 } });
+    AlgebraTAU::matrix<double> M2({ { 5, 4, 3 }, { 2, 1, 0 } });
+    AlgebraTAU::matrix<double> sum = M1 + M2, difference = M1 - M2;
+
+    // an rvalue operand lends its storage to the result
+    AlgebraTAU::matrix<double> a = M1;
+    const double* storage = &a(0, 0);
+    AlgebraTAU::matrix<double> res = std::move(a) + M2;
+    EXPECT_EQ(res, sum);
+    EXPECT_EQ(&res(0, 0), storage);
+
+    a = M2;
+    storage = &a(0, 0);
+    res = M1 - std::move(a);
+    EXPECT_EQ(res, difference);
+    EXPECT_EQ(&res(0, 0), storage);
+
+    EXPECT_EQ(AlgebraTAU::matrix<double>(M1) - AlgebraTAU::matrix<double>(M2), difference);
+    EXPECT_EQ(-(M1 - M2), M2 - M1);
+    EXPECT_EQ(2.0 * (M1 + M2), sum * 2.0);
+
+    AlgebraTAU::vector<AlgebraTAU::row, double> v({ 1, 2, 3 }), u({ 3, 2, 1 });
+    EXPECT_EQ(v - (u + v), -u);
+    EXPECT_EQ(2.0 * (v + u), (v + u) * 2.0);
+}
+
+TEST(MatrixOperators, StrassenWinograd)
+{
+    using AlgebraTAU::matrix;
+    using CryptoPP::Integer;
+
+    // odd dimensions above the crossover, so the recursion peels a row, a column and a term twice
+    std::mt19937 engine(11);
+    std::uniform_int_distribution<long> entry(-1000000, 1000000);
+    matrix<Integer> a(67, 65), b(65, 69), expected(67, 69, 0);
+    for (int i = 0; i < 67; ++i)
+        for (int j = 0; j < 65; ++j)
+            a(i, j) = Integer(entry(engine));
+    for (int i = 0; i < 65; ++i)
+        for (int j = 0; j < 69; ++j)
+            b(i, j) = Integer(entry(engine));
+    AlgebraTAU::multiply_add(a, b, expected, 0, 67, 0, 69);
+    const size_t crossover = AlgebraTAU::strassen_crossover<Integer>::value;
+    ASSERT_LE(crossover, 65);
+    EXPECT_EQ(a * b, expected);
+}
+
 TEST(AdvanceAlgebraicOperations, GaussianElimination)
 {
     AlgebraTAU::matrix<double> M({ { 1, 2, 2, 0, 5, 1, 7, 4 },
@@ -67,6 +124,37 @@ TEST(AdvanceAlgebraicOperations, GaussianElimination)
     EXPECT_TRUE(is_upper_triangular(M));
 }
 
+TEST(AdvanceAlgebraicOperations, BlockedGaussianElimination)
+{
+    // M = L * U for a unit lower triangular L, so eliminating M recovers U exactly
+    const int n = 80;
+    std::mt19937 engine(42);
+    std::uniform_int_distribution<int> entry(-1, 1), diagonal(1, 2);
+    AlgebraTAU::matrix<double> L(n, n, 0), U(n, n, 0);
+    double det = 1;
+    for (int i = 0; i < n; ++i)
+    {
+        L(i, i) = 1;
+        U(i, i) = diagonal(engine);
+        det *= U(i, i);
+        for (int j = 0; j < i; ++j)
+            L(i, j) = entry(engine);
+        for (int j = i + 1; j < n; ++j)
+            U(i, j) = entry(engine);
+    }
+
+    AlgebraTAU::matrix<double> M = L * U;
+    EXPECT_EQ(M.det(), det);
+    gaussian_elimination(M);
+    EXPECT_EQ(M, U);
+
+    // a column without a pivot is skipped
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> Z({ { 0, 1, 2 }, { 0, 3, 4 }, { 0, 5, 7 } });
+    gaussian_elimination(Z);
+    EXPECT_TRUE(is_upper_triangular(Z));
+    EXPECT_EQ(Z.det(), 0);
+}
+
 TEST(MatrixMethods, TransposeTranpose)
 {
     AlgebraTAU::matrix<double> M({ { 1, 2, 2, 0, 5, 1, 7, 4 },
@@ -77,6 +165,48 @@ TEST(MatrixMethods, TransposeTranpose)
     EXPECT_EQ(M, M.transpose().transpose());
 }
 
+TEST(MatrixMethods, BlockedTranspose)
+{
+    // shapes larger than a tile and not multiples of it
+    AlgebraTAU::matrix<double> M(70, 37);
+    for (int i = 0; i < 70; ++i)
+        for (int j = 0; j < 37; ++j)
+            M(i, j) = i * 100 + j;
+    AlgebraTAU::matrix<double> T = M.transpose();
+    ASSERT_EQ(T.rows(), 37);
+    ASSERT_EQ(T.columns(), 70);
+    for (int i = 0; i < 70; ++i)
+        for (int j = 0; j < 37; ++j)
+            EXPECT_EQ(T(j, i), M(i, j));
+
+    // the entries of the result aren't initialized before they are written, in every storage
+    AlgebraTAU::matrix<double, AlgebraTAU::copy_on_write<std::allocator<double>>> C(M);
+    EXPECT_EQ(AlgebraTAU::matrix<double>(C.transpose()), T);
+    {
+        AlgebraTAU::scoped_arena scope;
+        AlgebraTAU::arena_matrix<double> R(M);
+        EXPECT_EQ(AlgebraTAU::matrix<double>(R.transpose()), T);
+    }
+
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> F(37, 70);
+    for (int i = 0; i < 37; ++i)
+        for (int j = 0; j < 70; ++j)
+            F(i, j) = AlgebraTAU::Fraction(i, j + 1);
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> G = F.transpose();
+    EXPECT_EQ(AlgebraTAU::matrix<AlgebraTAU::Fraction>(G).transpose(), F);
+    for (int i = 0; i < 37; ++i)
+        for (int j = 0; j < 70; ++j)
+            EXPECT_EQ(G(j, i), AlgebraTAU::Fraction(i, j + 1));
+
+    AlgebraTAU::matrix<double> S = M.get_rows(0, 37), expected = S;
+    S.transpose_in_place();
+    EXPECT_EQ(S, expected.transpose());
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> H = G.get_rows(0, 37);
+    H.transpose_in_place();
+    EXPECT_EQ(H, G.get_rows(0, 37).transpose());
+    EXPECT_THROW(M.transpose_in_place(), std::domain_error);
+}
+
 TEST(VectorOperators, Transpose)
 {
     AlgebraTAU::vector<AlgebraTAU::row, double> v1({ 1, 2, 2, 0, 5, 1, 7, 4 });
@@ -140,3 +270,493 @@ TEST(AdvanceAlgebraicOperations, LLL_with_fraction)
 
     EXPECT_EQ(B, res);
 }
+
+TEST(AdvanceAlgebraicOperations, RecursiveLLL)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 0, 0, 0, 0, 0, 0, 0, 981 },
+                                                 { 0, 1, 0, 0, 0, 0, 0, 0, 771 },
+                                                 { 0, 0, 1, 0, 0, 0, 0, 0, 623 },
+                                                 { 0, 0, 0, 1, 0, 0, 0, 0, 457 },
+                                                 { 0, 0, 0, 0, 1, 0, 0, 0, 319 },
+                                                 { 0, 0, 0, 0, 0, 1, 0, 0, 277 },
+                                                 { 0, 0, 0, 0, 0, 0, 1, 0, 137 },
+                                                 { 0, 0, 0, 0, 0, 0, 0, 1, 2015 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> expected = B;
+
+    // only the final merge pass, on the calling thread, reports progress
+    AlgebraTAU::LLL_stats stats;
+    AlgebraTAU::LLL_options options;
+    std::thread::id caller = std::this_thread::get_id();
+    int reports = 0, foreign_reports = 0;
+    options.stats = &stats;
+    options.progress_interval = 1;
+    options.progress = [&](const AlgebraTAU::LLL_stats&, int) {
+        ++reports;
+        if (std::this_thread::get_id() != caller) ++foreign_reports;
+    };
+    AlgebraTAU::recursive_LLL(B, AlgebraTAU::Fraction(3, 4), 2, options);
+    AlgebraTAU::LLL(expected, AlgebraTAU::Fraction(3, 4));
+
+    EXPECT_TRUE(AlgebraTAU::is_LLL_reduced(B, AlgebraTAU::Fraction(3, 4)));
+    EXPECT_EQ((B * B.transpose()).det(), (expected * expected.transpose()).det());
+    EXPECT_GT(reports, 0);
+    EXPECT_EQ(foreign_reports, 0);
+}
+
+TEST(AdvanceAlgebraicOperations, GramSchmidtGcdCount)
+{
+    // wide enough that the rows are updated on the pool, the gcd calls of a run don't depend on
+    // the threads which ran its rows, or on the tasks of another run its thread helped with
+    typedef AlgebraTAU::matrix<AlgebraTAU::Fraction> matrix;
+    std::mt19937 engine(5);
+    std::uniform_int_distribution<int> entry(-3, 3);
+    matrix B(8, 4096);
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < 4096; ++j)
+            B(i, j) = entry(engine);
+
+    auto count = [&B]() {
+        matrix ortho = B, mu(8, 8);
+        std::vector<AlgebraTAU::Fraction> norms;
+        size_t res = 0;
+        AlgebraTAU::gram_schmidt(ortho, mu, norms, &res);
+        return res;
+    };
+    size_t alone = count(), concurrent[2];
+    std::thread other([&]() { concurrent[1] = count(); });
+    concurrent[0] = count();
+    other.join();
+
+    EXPECT_GT(alone, 0);
+    EXPECT_EQ(concurrent[0], alone);
+    EXPECT_EQ(concurrent[1], alone);
+}
+
+TEST(AdvanceAlgebraicOperations, LLL_stats)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 1, 1 }, { -1, 0, 2 }, { 3, 5, 6 } });
+    AlgebraTAU::LLL_stats stats;
+    AlgebraTAU::LLL_options options;
+    int reports = 0;
+    options.stats = &stats;
+    options.progress_interval = 1;
+    options.progress = [&reports](const AlgebraTAU::LLL_stats&, int) { ++reports; };
+
+    AlgebraTAU::LLL(B, AlgebraTAU::Fraction(3, 4), options);
+
+    EXPECT_GT(stats.iterations, 0);
+    EXPECT_GT(stats.swaps, 0);
+    EXPECT_GT(stats.gcd_calls, 0);
+    EXPECT_EQ(stats.max_bit_length, 3);
+    EXPECT_EQ(stats.gram_schmidt_calls, 1 + stats.swaps);
+    EXPECT_EQ(reports, stats.iterations + 2);
+    EXPECT_EQ(stats.log_potential.size(), reports);
+    EXPECT_LE(stats.log_potential.back(), stats.log_potential.front());
+
+    // an interval of 0 disables the periodic reports
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> C({ { 1, 1, 1 }, { -1, 0, 2 }, { 3, 5, 6 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> G = C * C.transpose();
+    stats = AlgebraTAU::LLL_stats();
+    reports = 0;
+    options.progress_interval = 0;
+    AlgebraTAU::LLL(C, AlgebraTAU::Fraction(3, 4), options);
+    EXPECT_EQ(reports, 2);
+    EXPECT_GT(stats.iterations, 0);
+    reports = 0;
+    AlgebraTAU::gram_LLL(G, AlgebraTAU::Fraction(3, 4), options);
+    EXPECT_EQ(reports, 0);
+}
+
+TEST(AdvanceAlgebraicOperations, LLL_checkpoint)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 0, 0, 0, 0, 981 },
+                                                 { 0, 1, 0, 0, 0, 771 },
+                                                 { 0, 0, 1, 0, 0, 623 },
+                                                 { 0, 0, 0, 1, 0, 457 },
+                                                 { 0, 0, 0, 0, 1, 319 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> expected = B;
+    AlgebraTAU::LLL(expected, AlgebraTAU::Fraction(3, 4));
+
+    // simulates a crash after a few iterations, the state is checkpointed at every iteration
+    AlgebraTAU::LLL_stats stats;
+    AlgebraTAU::LLL_options options;
+    options.stats = &stats;
+    options.progress_interval = 1;
+    options.progress = [](const AlgebraTAU::LLL_stats& s, int) {
+        if (s.iterations == 5) throw std::runtime_error("crash");
+    };
+    options.checkpoint_path = "lll_checkpoint_test.bin";
+    options.checkpoint_interval = std::chrono::seconds(0);
+    EXPECT_THROW(AlgebraTAU::LLL(B, AlgebraTAU::Fraction(3, 4), options), std::runtime_error);
+
+    AlgebraTAU::LLL_stats resumed_stats;
+    AlgebraTAU::LLL_options resumed_options;
+    resumed_options.stats = &resumed_stats;
+    AlgebraTAU::LLL_resume(B, options.checkpoint_path, resumed_options);
+    std::remove(options.checkpoint_path.c_str());
+
+    EXPECT_EQ(B, expected);
+    EXPECT_GE(resumed_stats.iterations, 4);
+}
+
+TEST(AdvanceAlgebraicOperations, RecursiveLLL_checkpoint)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 0, 0, 0, 0, 0, 0, 0, 981 },
+                                                 { 0, 1, 0, 0, 0, 0, 0, 0, 771 },
+                                                 { 0, 0, 1, 0, 0, 0, 0, 0, 623 },
+                                                 { 0, 0, 0, 1, 0, 0, 0, 0, 457 },
+                                                 { 0, 0, 0, 0, 1, 0, 0, 0, 319 },
+                                                 { 0, 0, 0, 0, 0, 1, 0, 0, 277 },
+                                                 { 0, 0, 0, 0, 0, 0, 1, 0, 137 },
+                                                 { 0, 0, 0, 0, 0, 0, 0, 1, 2015 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> original = B;
+
+    // simulates a crash in the merge pass, the halves reduce concurrently but don't checkpoint
+    AlgebraTAU::LLL_stats stats;
+    AlgebraTAU::LLL_options options;
+    int reports = 0;
+    options.stats = &stats;
+    options.progress_interval = 1;
+    options.progress = [&reports](const AlgebraTAU::LLL_stats&, int) {
+        if (++reports == 3) throw std::runtime_error("crash");
+    };
+    options.checkpoint_path = "recursive_lll_checkpoint_test.bin";
+    options.checkpoint_interval = std::chrono::seconds(0);
+    std::remove(options.checkpoint_path.c_str());
+
+    // crashing on the first report of the merge pass, before it checkpointed, leaves no checkpoint
+    reports = 2;
+    EXPECT_THROW(AlgebraTAU::recursive_LLL(B, AlgebraTAU::Fraction(3, 4), 2, options), std::runtime_error);
+    EXPECT_FALSE(std::ifstream(options.checkpoint_path).good());
+
+    B = original;
+    reports = 0;
+    EXPECT_THROW(AlgebraTAU::recursive_LLL(B, AlgebraTAU::Fraction(3, 4), 2, options), std::runtime_error);
+
+    // the checkpoint holds the whole basis
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> resumed(1, 1);
+    AlgebraTAU::LLL_resume(resumed, options.checkpoint_path);
+    std::remove(options.checkpoint_path.c_str());
+
+    ASSERT_EQ(resumed.rows(), original.rows());
+    EXPECT_TRUE(AlgebraTAU::is_LLL_reduced(resumed, AlgebraTAU::Fraction(3, 4)));
+    EXPECT_EQ((resumed * resumed.transpose()).det(), (original * original.transpose()).det());
+}
+
+TEST(AdvanceAlgebraicOperations, LLL_cancellation)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 0, 0, 0, 0, 981 },
+                                                 { 0, 1, 0, 0, 0, 771 },
+                                                 { 0, 0, 1, 0, 0, 623 },
+                                                 { 0, 0, 0, 1, 0, 457 },
+                                                 { 0, 0, 0, 0, 1, 319 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> C = B;
+    AlgebraTAU::cancellation_token token;
+    AlgebraTAU::LLL_options options;
+    options.cancel = &token;
+
+    AlgebraTAU::LLL(B, AlgebraTAU::Fraction(3, 4), options);
+    EXPECT_TRUE(AlgebraTAU::is_LLL_reduced(B, AlgebraTAU::Fraction(3, 4)));
+
+    token.set_budget(2);
+    token.spend(2);
+    EXPECT_FALSE(token.is_cancelled());
+    token.cancel();
+    EXPECT_THROW(AlgebraTAU::LLL(C, AlgebraTAU::Fraction(3, 4), options), AlgebraTAU::operation_cancelled);
+    // the basis is left unreduced but spans the same lattice
+    EXPECT_EQ(abs((C * C.transpose()).det()), abs((B * B.transpose()).det()));
+
+    AlgebraTAU::cancellation_token expired;
+    expired.set_timeout(std::chrono::seconds(-1));
+    EXPECT_THROW(expired.check(), AlgebraTAU::operation_cancelled);
+}
+
+TEST(AdvanceAlgebraicOperations, GramLLL)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 0, 0, 0, 0, 981, 1733 },
+                                                 { 0, 1, 0, 0, 0, 771, 345 },
+                                                 { 0, 0, 1, 0, 0, 623, 997 },
+                                                 { 0, 0, 0, 1, 0, 457, 1200 },
+                                                 { 0, 0, 0, 0, 1, 319, 42 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> G = B * B.transpose();
+
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> U = AlgebraTAU::gram_LLL(G, AlgebraTAU::Fraction(3, 4));
+    AlgebraTAU::LLL_via_gram(B, AlgebraTAU::Fraction(3, 4));
+
+    EXPECT_EQ(abs(U.det()), 1);
+    EXPECT_EQ(G, B * B.transpose());
+    EXPECT_TRUE(AlgebraTAU::is_LLL_reduced(B, AlgebraTAU::Fraction(3, 4)));
+}
+
+TEST(AdvanceAlgebraicOperations, RectangularGramSchmidt)
+{
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> B({ { 1, 2, 0, 1 }, { 3, 1, 1, 0 }, { 4, 3, 1, 1 } });
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> ortho = B, mu(1, 1);
+    std::vector<AlgebraTAU::Fraction> norms;
+
+    AlgebraTAU::gram_schmidt(ortho, mu, norms);
+
+    // the third row is the sum of the first two
+    EXPECT_EQ(mu * ortho, B);
+    EXPECT_TRUE(AlgebraTAU::is_lower_triangular(mu));
+    EXPECT_EQ(norms[0], 6);
+    EXPECT_EQ(norms[1], AlgebraTAU::Fraction(41, 6));
+    EXPECT_EQ(norms[2], 0);
+    EXPECT_EQ(ortho.get_row(2).norm(), 0);
+    EXPECT_EQ(dot(ortho.get_row(0), ortho.get_row(1)), 0);
+}
+
+TEST(ThreadPool, SubmitAndParallelFor)
+{
+    AlgebraTAU::thread_pool pool(4);
+    std::vector<int> values(1000, 0);
+
+    // nested parallel_for calls from inside the workers must not deadlock
+    std::future<int> sum = pool.submit([&pool, &values]() {
+        pool.parallel_for(0, 10, [&pool, &values](size_t i) {
+            pool.parallel_for(i * 100, (i + 1) * 100, [&values](size_t j) { values[j] = j; });
+        });
+        int res = 0;
+        for (int x : values)
+            res += x;
+        return res;
+    });
+
+    EXPECT_EQ(pool.get(sum), 999 * 1000 / 2);
+    EXPECT_THROW(pool.parallel_for(0, 100, [](size_t i) {
+        if (i == 42) throw std::runtime_error("task failed");
+    }),
+                 std::runtime_error);
+}
+
+TEST(Arena, ScopedArenaMatrix)
+{
+    using AlgebraTAU::arena;
+    AlgebraTAU::matrix<double> M({ { 1, 2, 3 }, { 4, 5, 6 } });
+
+    EXPECT_EQ(arena::current(), nullptr);
+    {
+        AlgebraTAU::scoped_arena scope;
+        EXPECT_EQ(arena::current(), &scope.get());
+
+        // freed blocks are recycled by the next allocation of the same size class
+        void* p = scope.get().allocate(40);
+        arena::deallocate(p);
+        EXPECT_EQ(scope.get().allocate(64), p);
+
+        AlgebraTAU::arena_matrix<double> A(M);
+        A *= 2;
+        EXPECT_EQ(AlgebraTAU::matrix<double>(A), M * 2.0);
+
+        {
+            AlgebraTAU::scoped_arena inner;
+            EXPECT_EQ(arena::current(), &inner.get());
+        }
+        EXPECT_EQ(arena::current(), &scope.get());
+    }
+    EXPECT_EQ(arena::current(), nullptr);
+
+    // without a current arena the blocks come from the heap
+    AlgebraTAU::arena_matrix<double> B(M);
+    EXPECT_EQ(AlgebraTAU::matrix<double>(B), M);
+}
+
+TEST(MatrixMethods, CopyOnWrite)
+{
+    typedef AlgebraTAU::cow_matrix<AlgebraTAU::Fraction> cow_matrix;
+    cow_matrix M({ { 1, 2 }, { 3, 4 }, { 5, 6 } });
+    const cow_matrix& view = M;
+    const cow_matrix snapshot = M;
+
+    // copies share the rows until one of them writes to a row
+    EXPECT_EQ(&snapshot(0, 0), &view(0, 0));
+    M(1, 0) = 7;
+    EXPECT_EQ(&snapshot(0, 0), &view(0, 0));
+    EXPECT_NE(&snapshot(1, 0), &view(1, 0));
+    EXPECT_EQ(snapshot(1, 0), 3);
+    EXPECT_EQ(M(1, 0), 7);
+
+    AlgebraTAU::matrix<AlgebraTAU::Fraction> dense(snapshot);
+    EXPECT_EQ(dense, AlgebraTAU::matrix<AlgebraTAU::Fraction>({ { 1, 2 }, { 3, 4 }, { 5, 6 } }));
+
+    cow_matrix basis({ { 1, 1, 1 }, { -1, 0, 2 }, { 3, 5, 6 } });
+    const cow_matrix original = basis;
+    AlgebraTAU::LLL(basis, AlgebraTAU::Fraction(3, 4));
+    EXPECT_TRUE(AlgebraTAU::is_LLL_reduced(basis, AlgebraTAU::Fraction(3, 4)));
+    EXPECT_EQ(original, cow_matrix({ { 1, 1, 1 }, { -1, 0, 2 }, { 3, 5, 6 } }));
+    EXPECT_EQ(basis.det().AbsoluteValue(), original.det().AbsoluteValue());
+}
+
+TEST(AdvanceAlgebraicOperations, NormalForms)
+{
+    using AlgebraTAU::matrix;
+    using CryptoPP::Integer;
+
+    matrix<Integer> B({ { 2, 3, 6, 2 }, { 5, 6, 1, 6 }, { 8, 3, 1, 1 }, { 3, 2, 7, 4 } });
+    matrix<Integer> H = B, inverse(4, 4);
+    matrix<Integer> U = AlgebraTAU::hermite_normal_form(H);
+    EXPECT_EQ(U * B, H);
+    // |det(B)| = 710
+    EXPECT_EQ(AlgebraTAU::integer_inverse(U, inverse).AbsoluteValue(), 1);
+    EXPECT_EQ(H(0, 0) * H(1, 1) * H(2, 2) * H(3, 3), 710);
+    EXPECT_TRUE(AlgebraTAU::is_upper_triangular(H));
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < i; ++j)
+            EXPECT_TRUE(H(j, i).NotNegative() && H(j, i) < H(i, i));
+
+    // a different basis of the same lattice, and rectangular matrices
+    matrix<Integer> V({ { 1, 2, 0, 0 }, { 0, 1, 0, 0 }, { 3, -1, 1, 0 }, { 0, 0, 5, 1 } });
+    EXPECT_TRUE(AlgebraTAU::same_lattice(B, matrix<Integer>(V * B)));
+    EXPECT_FALSE(AlgebraTAU::same_lattice(B, matrix<Integer>(B * Integer(2))));
+    matrix<Integer> R({ { 4, 6, 2 }, { 6, 9, 3 }, { 2, 3, 1 } }), R2({ { 2, 3, 1 } });
+    EXPECT_TRUE(AlgebraTAU::same_lattice(R, R2));
+    matrix<Integer> RH = R;
+    EXPECT_EQ(AlgebraTAU::hermite_normal_form(RH) * R, RH);
+
+    matrix<Integer> S({ { 2, 4, 4 }, { -6, 6, 12 }, { 10, -4, -16 } }), P(1, 1), Q(1, 1);
+    matrix<Integer> M = S;
+    AlgebraTAU::smith_normal_form(S, P, Q);
+    EXPECT_EQ(S, matrix<Integer>({ { 2, 0, 0 }, { 0, 6, 0 }, { 0, 0, 12 } }));
+    EXPECT_EQ(P * M * Q, S);
+    EXPECT_EQ(AlgebraTAU::integer_inverse(P, inverse).AbsoluteValue(), 1);
+    EXPECT_EQ(AlgebraTAU::integer_inverse(Q, inverse).AbsoluteValue(), 1);
+}
+
+TEST(AdvanceAlgebraicOperations, ModularArithmetic)
+{
+    using AlgebraTAU::matrix;
+    using AlgebraTAU::modint;
+    using CryptoPP::Integer;
+    typedef AlgebraTAU::modint998244353 F;
+
+    // det(L * U) is the product of the diagonal of U
+    const int n = 40;
+    std::mt19937 engine(7);
+    matrix<F> L(n, n, 0), U(n, n, 0);
+    F det = 1;
+    for (int i = 0; i < n; ++i)
+    {
+        L(i, i) = 1;
+        U(i, i) = 1 + engine() % (F::modulus() - 1);
+        det *= U(i, i);
+        for (int j = 0; j < i; ++j)
+            L(i, j) = engine();
+        for (int j = i + 1; j < n; ++j)
+            U(i, j) = engine();
+    }
+    matrix<F> M = L * U;
+    EXPECT_EQ(M.det(), det);
+    gaussian_elimination(M);
+    EXPECT_EQ(M, U);
+    EXPECT_EQ(F(3) / F(2) * F(2), 3);
+    EXPECT_EQ(-F(1), F::modulus() - 1);
+    EXPECT_THROW(F(1) / F(0), std::domain_error);
+
+    // det(B) = -710, reduced modulo the prime 2^127 - 1
+    Integer p = Integer::Power2(127) - Integer::One();
+    modint zero(Integer::Zero(), p);
+    matrix<modint> B({ { 2, 3, 6, 2 }, { 5, 6, 1, 6 }, { 8, 3, 1, 1 }, { 3, 2, 7, 4 } });
+    B(0, 0) = modint(Integer(2L), zero);
+    EXPECT_EQ(B.det(), modint(Integer(-710L), zero));
+    EXPECT_EQ(B.det().value(), p - Integer(710L));
+
+    typedef AlgebraTAU::vector<AlgebraTAU::column, modint> column;
+    EXPECT_EQ(B * column({ 1, -1, 0, 0 }), column({ -1, -1, 5, 1 }));
+
+    modint a(Integer(4L), Integer(6L)), b(Integer(3L), Integer(7L));
+    EXPECT_EQ(a * a, -2);
+    EXPECT_THROW(a.inverse(), std::domain_error);
+    EXPECT_THROW(a + b, std::invalid_argument);
+    EXPECT_THROW(modint(3) / modint(2), std::domain_error);
+}
+
+TEST(AdvanceAlgebraicOperations, LinearSystems)
+{
+    using AlgebraTAU::Fraction;
+    using AlgebraTAU::matrix;
+    typedef AlgebraTAU::vector<AlgebraTAU::column, Fraction> column;
+
+    matrix<Fraction> M({ { 1, 2, 1, 4 }, { 2, 4, 0, 6 }, { 3, 6, 1, 10 } });
+    matrix<Fraction> R = M;
+    std::vector<size_t> pivots = AlgebraTAU::reduced_row_echelon_form(R);
+    EXPECT_EQ(pivots, std::vector<size_t>({ 0, 2 }));
+    EXPECT_EQ(R, matrix<Fraction>({ { 1, 2, 0, 3 }, { 0, 0, 1, 1 }, { 0, 0, 0, 0 } }));
+    EXPECT_EQ(AlgebraTAU::rank(M), 2);
+    EXPECT_EQ(AlgebraTAU::rank(matrix<CryptoPP::Integer>({ { 2, 4, 6 }, { 1, 2, 3 } })), 1);
+
+    std::vector<column> basis = AlgebraTAU::kernel(M);
+    EXPECT_EQ(basis.size(), 2);
+    for (const column& x : basis)
+        EXPECT_EQ(M * x, column(3, 0));
+
+    // a consistent singular system is solved by elimination, an inconsistent one has no solution
+    column x = AlgebraTAU::solve(M, column({ 1, 2, 3 }));
+    EXPECT_EQ(M * x, column({ 1, 2, 3 }));
+    EXPECT_THROW(AlgebraTAU::solve(M, column({ 1, 2, 4 })), std::domain_error);
+
+    // a nonsingular system is solved by p-adic lifting
+    const int n = 12;
+    std::mt19937 engine(3);
+    std::uniform_int_distribution<int> entry(-50, 50), denominator(1, 9);
+    matrix<Fraction> A(n, n);
+    column b(n);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+            A(i, j) = Fraction(entry(engine), denominator(engine));
+        b(i) = Fraction(entry(engine), denominator(engine));
+    }
+    x = AlgebraTAU::solve(A, b);
+    EXPECT_EQ(A * x, b);
+    EXPECT_EQ(x, AlgebraTAU::echelon_solve(A, b));
+
+    // kernel vectors modulo a prime
+    typedef AlgebraTAU::static_modint<7> F;
+    matrix<F> P({ { 1, 2, 3 }, { 2, 4, 6 } });
+    std::vector<AlgebraTAU::vector<AlgebraTAU::column, F>> kernel = AlgebraTAU::kernel(P);
+    EXPECT_EQ(kernel.size(), 2);
+    for (const auto& y : kernel)
+        EXPECT_EQ(P * y, (AlgebraTAU::vector<AlgebraTAU::column, F>(2, 0)));
+}
+
+TEST(Attack, SeededRunsAreDeterministic)
+{
+    // the range attack checks its pivots on a pool of several threads, the oracle calls and the
+    // ranges must still be the same in every run of the same seed
+    SeededRng rng(7);
+    Server srv(384, rng);
+    Integer c = srv.pkcs_encrypt("x", rng);
+    AlgebraTAU::thread_pool pool(4);
+    AttackParams params;
+    params.number_of_blindings = 1;
+    params.seeded = true;
+    params.seed = 5;
+
+    uint64_t calls[2];
+    II ranges[2];
+    for (int run = 0; run < 2; ++run)
+    {
+        uint64_t before = attack_metrics().counter(attack_metric::oracle_calls);
+        AttackJob job(pool, srv, c, params);
+        job.calc_blindings();
+        job.calc_ranges();
+        calls[run] = attack_metrics().counter(attack_metric::oracle_calls) - before;
+        ranges[run] = job.get_range(0);
+    }
+    EXPECT_EQ(calls[0], calls[1]);
+    EXPECT_EQ(ranges[0], ranges[1]);
+    EXPECT_EQ(attack_metrics().counter(attack_metric::speculative_oracle_calls), 0);
+}
+
+TEST(Attack, KilledRangeAttackStops)
+{
+    // a range attack still running when the lattice recovered the message stops at its next pivot
+    SeededRng rng(7);
+    Server srv(384, rng);
+    Integer c = srv.pkcs_encrypt("x", rng);
+    std::atomic_bool kill(true);
+    RangeAttacker attacker(srv, c, nullptr, 1, nullptr, &kill);
+    attacker.reset();
+    EXPECT_THROW(attacker.attack(), std::runtime_error);
+    EXPECT_EQ(attacker.get_message_counter(), 0);
+}
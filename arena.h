@@ -0,0 +1,230 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+// a pool of memory blocks for the temporaries of a single thread
+// blocks are carved out of large chunks and recycled through a free list per size class (powers of
+// 2 from 16 bytes up to max_block_size), the chunks are released all together when the arena is
+// destroyed, so the memory of the temporaries of a long computation is allocated a handful of times
+// larger blocks are allocated on the heap
+// every block is preceded by a header naming its arena, so a block can be freed without knowing
+// where it came from, only the owning thread recycles its blocks, a block freed by another thread
+// (or while another arena is current) is kept until the bulk release
+// an arena is not thread safe, and a block must not be used after its arena was destroyed
+class arena
+{
+    public:
+    static const size_t alignment = 16;
+    static const size_t max_block_size = size_t(1) << 15;
+
+    private:
+    static const size_t min_block_size = 16;
+    static const size_t size_classes = 12;
+    static const size_t chunk_size = size_t(1) << 16;
+
+    struct alignas(alignment) header
+    {
+        // null for blocks allocated on the heap
+        arena* owner;
+        size_t size_class;
+    };
+
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    std::vector<char*> chunks;
+    char* chunk_begin = nullptr;
+    char* chunk_end = nullptr;
+    free_block* free_lists[size_classes] = {};
+
+    static arena*& current_slot()
+    {
+        static thread_local arena* current = nullptr;
+        return current;
+    }
+
+    static size_t size_class(size_t bytes)
+    {
+        size_t res = 0;
+        for (size_t size = min_block_size; size < bytes; size <<= 1)
+            ++res;
+        return res;
+    }
+
+    // bump allocates a new block of the given size class
+    header* carve(size_t cls)
+    {
+        size_t bytes = sizeof(header) + (min_block_size << cls);
+        if (chunk_end - chunk_begin < std::ptrdiff_t(bytes))
+        {
+            chunks.push_back(static_cast<char*>(::operator new(chunk_size)));
+            chunk_begin = chunks.back();
+            chunk_end = chunk_begin + chunk_size;
+        }
+        header* res = reinterpret_cast<header*>(chunk_begin);
+        chunk_begin += bytes;
+        return res;
+    }
+
+    public:
+    arena() = default;
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    ~arena()
+    {
+        for (char* chunk : chunks)
+            ::operator delete(chunk);
+    }
+
+    // the arena installed on the calling thread by the innermost scoped_arena, or null
+    static arena* current()
+    {
+        return current_slot();
+    }
+
+    // returns a block of at least bytes bytes, aligned to alignment
+    // throws std::bad_alloc if the memory can't be allocated
+    void* allocate(size_t bytes)
+    {
+        if (bytes > max_block_size) return allocate_heap(bytes);
+
+        size_t cls = size_class(bytes);
+        header* h;
+        if (free_lists[cls])
+        {
+            free_block* block = free_lists[cls];
+            free_lists[cls] = block->next;
+            h = reinterpret_cast<header*>(block) - 1;
+        }
+        else
+        {
+            h = carve(cls);
+        }
+        h->owner = this;
+        h->size_class = cls;
+        return h + 1;
+    }
+
+    // allocates from the current arena of the thread, or from the heap if there is none
+    static void* allocate_current(size_t bytes)
+    {
+        arena* a = current();
+        return a ? a->allocate(bytes) : allocate_heap(bytes);
+    }
+
+    // allocates a block on the heap, with a header like every other block
+    static void* allocate_heap(size_t bytes)
+    {
+        if (bytes > std::numeric_limits<size_t>::max() - sizeof(header)) throw std::bad_alloc();
+        header* h = static_cast<header*>(::operator new(sizeof(header) + bytes));
+        h->owner = nullptr;
+        h->size_class = 0;
+        return h + 1;
+    }
+
+    // frees a block returned by any of the allocate functions
+    static void deallocate(void* p)
+    {
+        if (p == nullptr) return;
+        header* h = static_cast<header*>(p) - 1;
+        if (h->owner == nullptr)
+        {
+            ::operator delete(h);
+            return;
+        }
+        if (h->owner != current()) return;
+
+        free_block* block = static_cast<free_block*>(p);
+        block->next = h->owner->free_lists[h->size_class];
+        h->owner->free_lists[h->size_class] = block;
+    }
+
+    friend class scoped_arena;
+};
+
+// creates an arena and makes it the current arena of the calling thread for its lifetime
+// scopes nest, the previous arena is current again once the scope ends
+// every container allocated from the arena must be destroyed before the scope ends
+class scoped_arena
+{
+    arena pool;
+    arena* previous;
+
+    public:
+    scoped_arena() : previous(arena::current_slot())
+    {
+        arena::current_slot() = &pool;
+    }
+
+    scoped_arena(const scoped_arena&) = delete;
+    scoped_arena& operator=(const scoped_arena&) = delete;
+
+    ~scoped_arena()
+    {
+        arena::current_slot() = previous;
+    }
+
+    arena& get()
+    {
+        return pool;
+    }
+};
+
+// a stateless allocator which allocates from the current arena of the calling thread (or from the
+// heap when there is none), so all its instances are interchangeable
+// meant for the temporaries of an algorithm, which run within a scoped_arena, see arena_matrix
+template <typename T>
+class arena_allocator
+{
+    static_assert(alignof(T) <= arena::alignment, "arena blocks are not aligned enough for T");
+
+    public:
+    typedef T value_type;
+
+    arena_allocator() = default;
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>&)
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(arena::allocate_current(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        arena::deallocate(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>&, const arena_allocator<U>&)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>&, const arena_allocator<U>&)
+{
+    return false;
+}
+
+} // namespace AlgebraTAU
+
+#endif
@@ -1,6 +1,15 @@
 #ifndef BASE_H
 #define BASE_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+
 #define self (*this)
 
 namespace AlgebraTAU
@@ -15,14 +24,61 @@ inline T sqaure(const T& t)
     return t * t;
 }
 
+// returns the number of bits needed to represent the integral part of |t|
+template <typename T>
+inline size_t bit_length(const T& t)
+{
+    return t == 0 ? 0 : std::max(std::ilogb(t) + 1, 0);
+}
+
+// writes the binary representation of t into os (native byte order)
+// scalar types which are not trivially copyable overload it
+template <typename T>
+inline void write_binary(std::ostream& os, const T& t)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "write_binary is not defined for T");
+    os.write(reinterpret_cast<const char*>(&t), sizeof(T));
+}
+
+// reads a binary representation written by write_binary from is into t
+template <typename T>
+inline void read_binary(std::istream& is, T& t)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "read_binary is not defined for T");
+    is.read(reinterpret_cast<char*>(&t), sizeof(T));
+}
+
+// returns the number of gcd computations the current thread preformed on scalars of type T
+// used for instrumentation only, scalar types that compute gcds overload it
+template <typename T>
+inline size_t gcd_calls(const T&)
+{
+    return 0;
+}
+
+// matrix products whose dimensions are all at least value are computed by strassen-winograd
+// recursion rather than by the classical algorithm, see matrix::operator*
+// the recursion trades a product of blocks for 15 sums of blocks, which pays off at small sizes for
+// big number types whose multiplication is much more expensive than their addition
+// floating point types never use it, its rounding errors are worse than those of the classical
+// product
+// scalar types specialize it with a crossover measured by the benchmarks
+template <typename T>
+struct strassen_crossover
+{
+    static const size_t value = std::is_arithmetic<T>::value ? std::numeric_limits<size_t>::max() : 32;
+};
+
 enum orientation
 {
     row = 0,
     column
 };
-template <orientation O, typename T>
+// A is the allocator of their storage, see arena.h for an allocator for temporaries and
+// storage.h for copy on write storage
+template <orientation O, typename T, typename A = std::allocator<T>>
 class vector;
-template <typename T>
+template <typename T, typename A = std::allocator<T>>
 class matrix;
 
 } // namespace AlgebraTAU
@@ -4,15 +4,23 @@
 #include <cryptopp/rsa.h>
 
 #include <chrono>
+#include <condition_variable>
 #include <exception>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <random>
+#include <set>
 #include <thread>
 #include <vector>
 
 #include "Fraction.h"
+#include "cancellation.h"
 #include "matrix.h"
+#include "metrics.h"
+#include "server.h"
 #include "vector.h"
 
 using AlgebraTAU::Fraction;
@@ -20,92 +28,69 @@ using CryptoPP::Integer;
 const int max_message_count = 20000;
 typedef std::pair<Integer, Integer> II;
 
-inline Integer div_ceil(const Integer& x, const Integer& y)
-{
-    return ((x + y - 1) / y);
-}
-
-class Server
+// the counters and histograms of attack_metrics(), in the order of their names
+struct attack_metric
 {
-    private:
-    CryptoPP::RSA::PrivateKey privateKey;
-
-    public:
-    int keysize;
-    CryptoPP::RSA::PublicKey publicKey;
-
-    Server(int keysize) : keysize(keysize)
-    {
-        CryptoPP::AutoSeededRandomPool prng;
-        privateKey.GenerateRandomWithKeySize(prng, keysize);
-        publicKey = CryptoPP::RSA::PublicKey(privateKey);
-    }
-
-    Server(const Server& srv)
-    : privateKey(srv.privateKey), keysize(srv.keysize), publicKey(srv.publicKey)
-    {
-    }
-
-    Server& operator=(const Server& srv)
-    {
-        publicKey = srv.publicKey;
-        privateKey = srv.privateKey;
-        keysize = srv.keysize;
-        return *this;
-    }
-
-    bool is_pkcs_conforming(const Integer& c) const
+    enum counter
     {
-        CryptoPP::AutoSeededRandomPool prng;
-        Integer m = privateKey.CalculateInverse(prng, c);
-        int sz = m.ByteCount();
-        if (sz * 8 != keysize - 8) return false;
-        if (m.GetByte(sz - 1) != 2) return false;
-        for (int i = sz - 2; i > sz - 10; --i)
-            if (m.GetByte(i) == 0) return false;
-        for (int i = sz - 10; i >= 0; --i)
-            if (m.GetByte(i) == 0) return true;
-        return false;
-    }
+        oracle_calls,
+        speculative_oracle_calls,
+        blinding_attempts,
+        blindings_found,
+        range_attacks,
+        step_2a,
+        step_2b,
+        step_2c,
+        interval_divisions,
+        lattice_attempts,
+        blinding_time_us,
+        range_time_us,
+        lattice_time_us,
+        LLL_time_us
+    };
 
-    Integer pkcs_encrypt(const std::string& s) const
+    enum histogram
     {
-        int max_size = publicKey.GetModulus().ByteCount() - 11;
-        if (s.length() > max_size)
-            throw std::overflow_error("message too long, max size is " + std::to_string(max_size));
-
-        int pad = publicKey.GetModulus().ByteCount() - 3 - s.length();
-        uint16_t rnd;
-        Integer res = Integer::Power2(keysize) - 1;
-        int sz = res.ByteCount();
-        res.SetByte(sz - 2, 2);
-
-        for (int i = 0; i < pad; ++i)
-        {
-            do
-            {
-                rnd = random() % 256;
-            } while (rnd == 0);
-            res.SetByte(sz - 3 - i, rnd);
-        }
-        res.SetByte(sz - 3 - pad, 0);
+        oracle_calls_per_attacker,
+        intervals
+    };
+};
 
-        for (int i = 0; i < s.length(); ++i)
-            res.SetByte((sz - 4 - pad) - i, s[i]);
+// the metrics of all the attacks of the process
+// times are summed over the threads, so a phase run by several threads may take longer than the run
+AlgebraTAU::metrics& attack_metrics()
+{
+    static AlgebraTAU::metrics res({ "oracle_calls", "speculative_oracle_calls", "blinding_attempts",
+                                     "blindings_found", "range_attacks", "step_2a", "step_2b", "step_2c",
+                                     "interval_divisions", "lattice_attempts", "blinding_time_us",
+                                     "range_time_us", "lattice_time_us", "LLL_time_us" },
+                                   { "oracle_calls_per_attacker", "intervals" });
+    return res;
+}
 
-        res.SetByte(sz - 1, 0);
-        return publicKey.ApplyFunction(res);
-    }
-};
+inline Integer div_ceil(const Integer& x, const Integer& y)
+{
+    return ((x + y - 1) / y);
+}
 
 // helper class to help messuring times
 // only used for debbuging, has no actual effect
+// writes nothing unless verbose is set, the threads would serialize on the stream otherwise, the
+// numbers are in attack_metrics()
 class Logger
 {
     std::string name = "";
     std::ostream& os;
 
+    static std::ostream& null_stream()
+    {
+        static std::ostream res(nullptr);
+        return res;
+    }
+
     public:
+    static bool verbose;
+
     Logger(std::ostream& os) : os(os)
     {
     }
@@ -117,11 +102,13 @@ class Logger
 
     std::ostream& debug(int t = 0)
     {
+        if (!verbose) return null_stream();
         for (int i = 0; i < t; ++i)
             os << "\t";
         return os << name << " debug: ";
     }
 };
+bool Logger::verbose = false;
 
 class Attacker
 {
@@ -136,6 +123,10 @@ class Attacker
     int message_counter;
     const Server& srv;
     const Integer& c;
+    Server::Oracle oracle;
+    // if not null, every message is spent from its budget and the attacker throws
+    // operation_cancelled once it is cancelled
+    AlgebraTAU::cancellation_token* token;
 
     protected:
     Logger clog;
@@ -145,18 +136,69 @@ class Attacker
     inline bool is_good_pivot(const Integer& s)
     {
         ++message_counter;
+        attack_metrics().add(attack_metric::oracle_calls);
+        if (limitation > 0 && message_counter > limitation)
+            throw std::runtime_error("message limitation was reached");
+        if (token != nullptr) token->spend();
+        return oracle.is_good_pivot(s);
+    }
+
+    // returns the index of the first good pivot in candidates, or -1 if there is none
+    // the candidates are checked in parallel on the pool, if there is one
+    int first_good_pivot(const std::vector<Integer>& candidates, AlgebraTAU::thread_pool* pool)
+    {
+        int res = -1;
+        if (pool == nullptr || candidates.size() == 1)
+        {
+            for (int i = 0; res < 0 && i < candidates.size(); ++i)
+                if (is_good_pivot(candidates[i])) res = i;
+            return res;
+        }
+
+        // every query sent is charged, including the ones a sequential search wouldn't have sent,
+        // which are also counted as speculative
+        int queries = 0, sequential_queries = 0;
+        res = oracle.first_good_pivot(candidates, *pool, &queries, &sequential_queries);
+        message_counter += queries;
+        attack_metrics().add(attack_metric::oracle_calls, queries);
+        attack_metrics().add(attack_metric::speculative_oracle_calls, queries - sequential_queries);
         if (limitation > 0 && message_counter > limitation)
             throw std::runtime_error("message limitation was reached");
-        return srv.is_pkcs_conforming(srv.publicKey.ApplyFunction(s).Times(c).Modulo(n));
+        if (token != nullptr) token->spend(queries);
+        return res;
+    }
+
+    // throws operation_cancelled if the token is cancelled
+    void check_cancelled() const
+    {
+        if (token != nullptr) token->check();
     }
 
     public:
-    Attacker(const Server& srv, const Integer& c, const std::string& base_name, int limitation = max_message_count)
-    : base_name(base_name), limitation(limitation), srv(srv), c(c), clog(std::clog),
-      n(srv.publicKey.GetModulus()), B(Integer::Power2(srv.publicKey.GetModulus().BitCount() - 16))
+    Attacker(const Server& srv,
+             const Integer& c,
+             const std::string& base_name,
+             AlgebraTAU::cancellation_token* token = nullptr,
+             int limitation = max_message_count)
+    : base_name(base_name), limitation(limitation), message_counter(0), srv(srv), c(c), oracle(srv, c),
+      token(token), clog(std::clog), n(srv.publicKey.GetModulus()),
+      B(Integer::Power2(srv.publicKey.GetModulus().BitCount() - 16))
     {
     }
 
+    ~Attacker()
+    {
+        record_message_counter();
+    }
+
+    // adds the messages sent since the last reset to the oracle_calls_per_attacker histogram
+    void record_message_counter()
+    {
+        if (message_counter > 0)
+            attack_metrics().record(attack_metric::oracle_calls_per_attacker, message_counter);
+        message_counter = 0;
+    }
+
     int get_message_counter() const
     {
         return message_counter;
@@ -170,7 +212,7 @@ class Attacker
     {
         std::lock_guard<std::mutex> lock(Attacker::id_mutex);
         clog.set_name(base_name + " (" + std::to_string(id++) + ")");
-        message_counter = 0;
+        record_message_counter();
         debug() << "Beginning" << std::endl;
     }
 };
@@ -182,8 +224,11 @@ class BlindingAttacker : public Attacker
     const std::atomic_bool* pkill;
 
     public:
-    BlindingAttacker(const Server& srv, const Integer& c, const std::atomic_bool* pkill = nullptr)
-    : Attacker(srv, c, "Blinding Attacker"), pkill(pkill)
+    BlindingAttacker(const Server& srv,
+                     const Integer& c,
+                     const std::atomic_bool* pkill = nullptr,
+                     AlgebraTAU::cancellation_token* token = nullptr)
+    : Attacker(srv, c, "Blinding Attacker", token), pkill(pkill)
     {
     }
 
@@ -194,11 +239,19 @@ class BlindingAttacker : public Attacker
 
     Integer blind()
     {
+        static thread_local CryptoPP::AutoSeededRandomPool prng;
+        return blind(prng);
+    }
+
+    // draws the candidates from rng
+    Integer blind(CryptoPP::RandomNumberGenerator& rng)
+    {
+        attack_metrics().add(attack_metric::blinding_attempts);
+        AlgebraTAU::scoped_timer timer(attack_metrics(), attack_metric::blinding_time_us);
         Integer s = 0;
-        CryptoPP::AutoSeededRandomPool prng;
         do
         {
-            s.Randomize(prng, 2, n / 2);
+            s.Randomize(rng, 2, n / 2);
         } while (!is_good_pivot(s) && not_killed());
         return s;
     }
@@ -206,69 +259,52 @@ class BlindingAttacker : public Attacker
 
 class RangeAttacker : public Attacker
 {
+    // a set of disjoint intervals, ordered by their beginning
+    // overlapping intervals are merged when inserted, and the total size is kept up to date, so
+    // size() and count() are O(1) and insert() is O(log n) plus the merges
     class Intervals
     {
-        public:
-        std::vector<II> arr;
-
-        // turn the set of non-disjoint intervals in "arr" to a set of disjoint intervals
-        void sort()
+        struct by_begin
         {
-            std::sort(arr.begin(), arr.end(),
-                      [](const II& i1, const II& i2) { return i1.first > i2.first; });
-
-            int index = 0;
-            for (int i = 0; i < arr.size(); ++i)
+            bool operator()(const II& i1, const II& i2) const
             {
-                if (index != 0 && arr[index - 1].first <= arr[i].second)
-                {
-                    while (index != 0 && arr[index - 1].first <= arr[i].second)
-                    {
-                        arr[index - 1].second = std::max(arr[index - 1].second, arr[i].second);
-                        arr[index - 1].first = std::min(arr[index - 1].first, arr[i].first);
-                        --index;
-                    }
-                }
-                else
-                    arr[index] = arr[i];
-
-                ++index;
+                return i1.first < i2.first;
             }
+        };
+
+        std::set<II, by_begin> arr;
+        Integer total_size;
 
-            while (arr.size() > index)
-                arr.pop_back();
+        public:
+        typedef std::set<II, by_begin>::const_iterator const_iterator;
+
+        const_iterator begin() const
+        {
+            return arr.begin();
         }
 
-        // returns the first element
-        II& front()
+        const_iterator end() const
         {
-            return arr.front();
+            return arr.end();
         }
 
+        // returns the first interval
         const II& front() const
         {
-            return arr.front();
+            return *arr.begin();
         }
 
+        // returns the smallest interval containing all the intervals
         II enclose() const
         {
-            II res = front();
-            for (const II& p : arr)
-            {
-                if (p.first < res.first) res.first = p.first;
-                if (p.second > res.second) res.second = p.second;
-            }
-            return res;
+            return II(arr.begin()->first, arr.rbegin()->second);
         }
 
         // returns the sum of sizes of intervals
         // i.e the number of integers that belongs to some interval
-        Integer size() const
+        const Integer& size() const
         {
-            Integer res = 0;
-            for (const II& p : arr)
-                res += p.second - p.first + 1;
-            return res;
+            return total_size;
         }
 
         // returns the number of disjoint intervals
@@ -277,39 +313,94 @@ class RangeAttacker : public Attacker
             return arr.size();
         }
 
-        // inserts an elment to the set of intervals
-        void insert(const Integer& a, const Integer& b)
+        // inserts the interval [a, b], merging it with the intervals it overlaps
+        void insert(Integer a, Integer b)
         {
-            arr.push_back(std::make_pair(std::move(a), std::move(b)));
+            // the intervals beginning after b don't overlap, the ones before it overlap iff they
+            // end at a or after it
+            auto it = arr.upper_bound(II(b, b));
+            while (it != arr.begin())
+            {
+                auto prev = std::prev(it);
+                if (prev->second < a) break;
+                if (prev->first < a) a = prev->first;
+                if (prev->second > b) b = prev->second;
+                total_size -= prev->second - prev->first + 1;
+                it = arr.erase(prev);
+            }
+            total_size += b - a + 1;
+            arr.emplace_hint(it, std::move(a), std::move(b));
         }
     };
 
     Intervals M;
     Integer s;
 
+    // steps 2.a, 2.b and 2.c check this many pivots at a time on the pool
+    AlgebraTAU::thread_pool* pool;
+    int batch_size;
+    std::vector<Integer> candidates;
+    const std::atomic_bool* pkill;
+
+    // throws std::runtime_error once *pkill is set
+    void check_killed() const
+    {
+        if (pkill != nullptr && *pkill) throw std::runtime_error("attacker was killed");
+    }
+
+    // adds a candidate pivot to the current batch, and checks the batch once it is full
+    // returns true and sets s if a good pivot was found
+    bool add_candidate(const Integer& t)
+    {
+        check_killed();
+        candidates.push_back(t);
+        if (candidates.size() < batch_size) return false;
+
+        int i = first_good_pivot(candidates, pool);
+        if (i >= 0) s = candidates[i];
+        candidates.clear();
+        return i >= 0;
+    }
+
     public:
-    RangeAttacker(const Server& srv, const Integer& c) : Attacker(srv, c, "Range Attacker")
+    // a batch_size of 1, or no pool, checks the pivots one by one in the calling thread
+    // if pkill is set, the attack stops with std::runtime_error once *pkill is true, e.g once the
+    // message was recovered from the ranges of other attackers
+    RangeAttacker(const Server& srv,
+                  const Integer& c,
+                  AlgebraTAU::thread_pool* pool = nullptr,
+                  int batch_size = 1,
+                  AlgebraTAU::cancellation_token* token = nullptr,
+                  const std::atomic_bool* pkill = nullptr)
+    : Attacker(srv, c, "Range Attacker", token), pool(pool), batch_size(std::max(batch_size, 1)),
+      pkill(pkill)
     {
     }
 
     void attack()
     {
+        AlgebraTAU::metrics& metrics = attack_metrics();
+        metrics.add(attack_metric::range_attacks);
         M.insert(2 * B, 3 * B - 1);
         s = div_ceil(n, 3 * B);
         incremental_search(); // step 2.a
+        metrics.add(attack_metric::step_2a);
         debug() << "finished step 2.a" << std::endl;
 
         for (int i = 1; M.size() > 0; ++i)
         {
+            check_killed();
             if (i != 1 && M.count() > 1)
             {
                 ++s;
                 incremental_search();
+                metrics.add(attack_metric::step_2b);
                 if (i % 100 == 0) debug() << "finished step 2.b for i=" << i << std::endl;
             }
             else if (i != 1 && M.count() == 1)
             {
                 repivot();
+                metrics.add(attack_metric::step_2c);
                 if (i % 100 == 0) debug() << "finished step 2.c for i=" << i << std::endl;
             }
             interval_divsion();
@@ -321,24 +412,69 @@ class RangeAttacker : public Attacker
         return M.enclose();
     }
 
+    // interval_divsion splits the intervals over the pool if there are at least this many of them
+    static const int parallel_division_intervals = 8;
+
+    // scratch space of divide_interval, kept per thread so the Integers keep their buffers
+    struct division_scratch
+    {
+        Integer r, end, lo, hi, na, nb, remainder;
+    };
+
+    // appends the intersections of [a, b] with [ceil((2B + rn) / s), floor((3B - 1 + rn) / s)] for
+    // every r in [ceil((as - 3B + 1) / n), floor((bs - 2B) / n)] to res
+    // the bounds are updated by adding n for every r, instead of being calculated again
+    void divide_interval(const II& p, std::vector<II>& res) const
+    {
+        static thread_local division_scratch t;
+        const Integer& a = p.first;
+        const Integer& b = p.second;
+
+        t.r = div_ceil(a * s - 3 * B + 1, n);
+        t.end = (b * s - 2 * B) / n;
+        // lo = 2B + rn + s - 1 and hi = 3B - 1 + rn, so the bounds are lo / s and hi / s rounded down
+        t.hi = t.r * n;
+        t.lo = t.hi;
+        t.lo += 2 * B + s - 1;
+        t.hi += 3 * B - 1;
+        for (; t.r <= t.end; ++t.r, t.lo += n, t.hi += n)
+        {
+            check_cancelled();
+            Integer::Divide(t.remainder, t.na, t.lo, s);
+            Integer::Divide(t.remainder, t.nb, t.hi, s);
+            if (t.na < a) t.na = a;
+            if (t.nb > b) t.nb = b;
+            if (t.na <= t.nb) res.emplace_back(t.na, t.nb);
+        }
+    }
+
     // step 3
+    // the intervals are divided in parallel on the pool if there are many of them, the new intervals
+    // are merged into a new set which replaces M
     void interval_divsion()
     {
-        Intervals res;
-        for (const auto& p : M.arr)
+        bool parallel = pool != nullptr && M.count() >= parallel_division_intervals;
+        std::vector<std::vector<II>> pieces(parallel ? M.count() : 1);
+        if (parallel)
         {
-            const Integer& a = p.first;
-            const Integer& b = p.second;
-            Integer begin = div_ceil(a * s - 3 * B + 1, n), end = (b * s - 2 * B) / n;
-            for (Integer r = begin; r <= end; ++r)
-            {
-                Integer na = std::max(a, div_ceil(2 * B + r * n, s)),
-                        nb = std::min(b, (3 * B - 1 + r * n) / s);
-                res.insert(std::move(na), std::move(nb));
-            }
+            std::vector<const II*> intervals;
+            for (const II& p : M)
+                intervals.push_back(&p);
+            pool->parallel_for(0, intervals.size(), [&](size_t i) { divide_interval(*intervals[i], pieces[i]); });
         }
-        res.sort();
-        M = res;
+        else
+        {
+            for (const II& p : M)
+                divide_interval(p, pieces[0]);
+        }
+
+        Intervals res;
+        for (auto& v : pieces)
+            for (II& p : v)
+                res.insert(std::move(p.first), std::move(p.second));
+        M = std::move(res);
+        attack_metrics().add(attack_metric::interval_divisions);
+        attack_metrics().record(attack_metric::intervals, M.count());
     }
 
     // step 2.c
@@ -346,58 +482,82 @@ class RangeAttacker : public Attacker
     {
         const Integer& a = M.front().first;
         const Integer& b = M.front().second;
+        candidates.clear();
         for (Integer r = div_ceil(2 * b * s - 4 * B, n);; ++r)
-            for (s = div_ceil(2 * B + r * n, b); s < div_ceil(3 * B + r * n, a); ++s)
-                if (is_good_pivot(s)) return;
+            for (Integer t = div_ceil(2 * B + r * n, b); t < div_ceil(3 * B + r * n, a); ++t)
+                if (add_candidate(t)) return;
     }
 
     // step 2.a
     // step 2.b
     void incremental_search()
     {
-        while (!is_good_pivot(s))
-        {
-            ++s;
-        }
+        candidates.clear();
+        for (Integer t = s;; ++t)
+            if (add_candidate(t)) return;
     }
 };
 
-class MultiThreadAttack
+// parameters of an attack
+// min_lattice_ranges = 0 means number_of_blindings / 2
+// narrow_range_bits = 0 means half of the key size
+// the range attacks check pivot_batch_size pivots at a time, spread over the pool's idle workers
+// in the seeded mode the i'th blinding is drawn from SeededRng(seed, i + 1) and the pivots are
+// checked one at a time, since the number of pivots the workers check past a good one depends on
+// the timing of the threads, see AttackJob::run
+// if token is set, the attackers spend their messages from its budget and the job stops with
+// operation_cancelled once it is cancelled, a token shared by several jobs shares its budget too
+struct AttackParams
 {
+    int number_of_blindings = 20;
+    int min_lattice_ranges = 0;
+    int narrow_range_bits = 0;
+    int pivot_batch_size = 32;
+    bool seeded = false;
+    uint64_t seed = 0;
+    std::shared_ptr<AlgebraTAU::cancellation_token> token;
+};
 
-    public:
-    static MultiThreadAttack& get_instance()
-    {
-        static MultiThreadAttack instance;
-        return instance;
-    }
-
-    private:
-    // singelton design pattern
-    MultiThreadAttack()
-    {
-    }
-
-    MultiThreadAttack(MultiThreadAttack const&) = delete;
-    void operator=(MultiThreadAttack const&) = delete;
-
-    private:
-    const Server* srv;
-    const Integer* c;
+// the state of a single attack on a single ciphertext
+// a job owns copies of the server and the ciphertext, so several jobs can run at the same time
+class AttackJob
+{
+    const Server srv_copy;
+    const Integer c_copy;
+    const Server* srv = &srv_copy;
+    const Integer* c = &c_copy;
 
-    const int thread_num = std::max(int(std::thread::hardware_concurrency()), 1);
+    // the pool of the engine which runs the job
+    AlgebraTAU::thread_pool& pool;
 
     int number_of_blindings;
 
     std::atomic_bool finish_blinding;
-    std::mutex blindings_mutex;
+    // blindings has number_of_blindings slots, the i'th blinding found is stored in blindings[i]
+    std::atomic_int blindings_found;
     std::vector<Integer> blindings;
 
-    int current_range;
     std::vector<II> ranges;
-    std::mutex current_range_mutex;
+    std::mutex ranges_mutex;
+
+    // pipelined mode, see calc_pipelined
+    // indices of the blindings whose range attack finished with a narrow enough range
+    std::vector<int> narrow_ranges;
+    // a lattice reduction is attempted once this many narrow ranges are known
+    int min_lattice_ranges;
+    // a range [a, b] is narrow enough if b - a has at most this many bits
+    int narrow_range_bits;
+    int pivot_batch_size;
+    bool seeded;
+    uint64_t seed;
+    std::shared_ptr<AlgebraTAU::cancellation_token> token;
+    // number of narrow ranges the last lattice attempt used
+    int last_lattice_ranges;
+    std::mutex lattice_mutex;
+    std::atomic_bool found_result;
 
     Integer m;
+    Logger log;
 
     std::string pkcs_decode(const Integer& m) const
     {
@@ -422,26 +582,25 @@ class MultiThreadAttack
         return res.data();
     }
 
-    static void blinding_thread()
+    void blinding_thread()
     {
-        MultiThreadAttack& MTA = get_instance();
-        BlindingAttacker attacker(*MTA.srv, *MTA.c, &MTA.finish_blinding);
+        BlindingAttacker attacker(*srv, *c, &finish_blinding, token.get());
         Integer blind_value;
 
-        while (!MTA.finish_blinding)
+        while (!finish_blinding)
         {
             attacker.reset();
             try
             {
                 blind_value = attacker.blind();
-                if (MTA.finish_blinding) break;
+                if (finish_blinding) break;
                 attacker.debug() << "Found blinding value!" << std::endl;
-                {
-                    std::lock_guard<std::mutex> lock(MTA.blindings_mutex);
-                    MTA.blindings.push_back(blind_value);
-                    std::clog << "Number of blindings found " << MTA.blindings.size() << std::endl;
-                    if (MTA.blindings.size() >= MTA.number_of_blindings) MTA.finish_blinding = true;
-                }
+                if (store_blinding(blind_value) < 0) break;
+            }
+            catch (const AlgebraTAU::operation_cancelled&)
+            {
+                finish_blinding = true;
+                throw;
             }
             catch (std::exception& e)
             {
@@ -450,99 +609,305 @@ class MultiThreadAttack
         }
     }
 
-    static void range_thread()
+    // searches the i'th blinding of the seeded mode, it isn't killed when other blindings are found
+    void seeded_blinding_job(int i)
     {
-        MultiThreadAttack& MTA = get_instance();
-        int i;
-        Integer c0;
+        BlindingAttacker attacker(*srv, *c, nullptr, token.get());
+        SeededRng rng(seed, i + 1);
+
         while (true)
         {
+            attacker.reset();
+            try
+            {
+                blindings[i] = attacker.blind(rng);
+                attack_metrics().add(attack_metric::blindings_found);
+                attacker.debug() << "Found blinding value!" << std::endl;
+                break;
+            }
+            catch (const AlgebraTAU::operation_cancelled&)
+            {
+                throw;
+            }
+            catch (std::exception& e)
             {
-                std::lock_guard<std::mutex> lock(MTA.current_range_mutex);
-                i = MTA.current_range++;
+                attacker.debug() << "Killed before blinding value found" << std::endl;
             }
-            if (i >= MTA.number_of_blindings) break;
+        }
+    }
+
+    // stores a blinding value in the next free slot and returns its index
+    // returns -1 if all the slots are already taken
+    int store_blinding(const Integer& blind_value)
+    {
+        int i = blindings_found++;
+        if (i >= number_of_blindings) return -1;
+        blindings[i] = blind_value;
+        attack_metrics().add(attack_metric::blindings_found);
+        log.debug() << "Number of blindings found " << i + 1 << std::endl;
+        if (i + 1 >= number_of_blindings) finish_blinding = true;
+        return i;
+    }
+
+    // runs the range attack for the i'th blinding and stores its result in ranges[i]
+    // the attack is killed once a lattice reduction recovered the message, like an attack which
+    // reached its message limit, and then ranges[i] is the range it narrowed down so far
+    void range_job(int i)
+    {
+        Integer c0 = srv->publicKey.ApplyFunction(blindings[i]).Times(*c).Modulo(srv->publicKey.GetModulus());
+        AlgebraTAU::scoped_timer timer(attack_metrics(), attack_metric::range_time_us);
+        RangeAttacker attacker(*srv, c0, &pool, seeded ? 1 : pivot_batch_size, token.get(), &found_result);
+
+        try
+        {
+            attacker.reset();
+            attacker.attack();
+            attacker.debug() << "Found final value!" << std::endl;
+        }
+        catch (const AlgebraTAU::operation_cancelled&)
+        {
+            finish_blinding = true;
+            throw;
+        }
+        catch (std::exception& e)
+        {
+            attacker.debug() << "Killed before final value found" << std::endl;
+        }
+        ranges[i] = attacker.result();
+    }
+
+    // runs a lattice reduction over the narrow ranges found so far, if there are enough of them
+    // and no other thread is already doing so
+    void try_lattice()
+    {
+        std::unique_lock<std::mutex> lattice_lock(lattice_mutex, std::try_to_lock);
+        if (!lattice_lock.owns_lock() || found_result) return;
+
+        std::vector<int> indices;
+        {
+            std::lock_guard<std::mutex> lock(ranges_mutex);
+            indices = narrow_ranges;
+        }
+        if (indices.size() < min_lattice_ranges || indices.size() <= last_lattice_ranges) return;
+        last_lattice_ranges = indices.size();
+
+        log.debug() << "Trying lattice reduction with " << indices.size() << " ranges" << std::endl;
+        if (calc_result(indices))
+        {
+            log.debug() << "Lattice reduction succeeded" << std::endl;
+            found_result = true;
+            finish_blinding = true;
+        }
+    }
 
-            c0 = MTA.srv->publicKey.ApplyFunction(MTA.blindings[i])
-                 .Times(*MTA.c)
-                 .Modulo(MTA.srv->publicKey.GetModulus());
-            RangeAttacker attacker(*MTA.srv, c0);
+    // searches blindings, and runs the range attack of each blinding right after it is found
+    void pipeline_thread()
+    {
+        BlindingAttacker attacker(*srv, *c, &finish_blinding, token.get());
+        Integer blind_value;
+        int i;
 
+        while (!finish_blinding)
+        {
+            attacker.reset();
             try
             {
-                attacker.reset();
-                attacker.attack();
-                attacker.debug() << "Found final value!" << std::endl;
+                blind_value = attacker.blind();
+            }
+            catch (const AlgebraTAU::operation_cancelled&)
+            {
+                finish_blinding = true;
+                throw;
             }
             catch (std::exception& e)
             {
-                attacker.debug() << "Killed before final value found" << std::endl;
+                attacker.debug() << "Killed before blinding value found" << std::endl;
+                continue;
             }
-            MTA.ranges[i] = attacker.result();
+            if (finish_blinding) break;
+            attacker.debug() << "Found blinding value!" << std::endl;
+            if ((i = store_blinding(blind_value)) < 0) break;
+
+            range_job(i);
+            {
+                std::lock_guard<std::mutex> lock(ranges_mutex);
+                const II& range = ranges[i];
+                if ((range.second - range.first).BitCount() <= narrow_range_bits)
+                    narrow_ranges.push_back(i);
+            }
+            try_lattice();
         }
     }
 
     public:
-    void set_params(const Server& srv, const Integer& c, int number_of_blindings)
+    AttackJob(AlgebraTAU::thread_pool& pool, const Server& srv, const Integer& c, const AttackParams& params)
+    : srv_copy(srv), c_copy(c), pool(pool), number_of_blindings(params.number_of_blindings),
+      finish_blinding(false), blindings_found(0), blindings(number_of_blindings),
+      ranges(number_of_blindings),
+      min_lattice_ranges(params.min_lattice_ranges > 0 ? params.min_lattice_ranges :
+                                                         std::max(number_of_blindings / 2, 1)),
+      narrow_range_bits(params.narrow_range_bits > 0 ? params.narrow_range_bits : srv.keysize / 2),
+      pivot_batch_size(params.pivot_batch_size), seeded(params.seeded), seed(params.seed), token(params.token),
+      last_lattice_ranges(0), found_result(false), log(std::clog)
     {
-        this->srv = &srv;
-        this->c = &c;
-        this->number_of_blindings = number_of_blindings;
-        blindings.clear();
-        finish_blinding = false;
-        current_range = 0;
-        ranges = std::vector<II>(number_of_blindings);
+        log.set_name("Attack Job");
     }
 
-    void calc_blindings()
+    AttackJob(const AttackJob&) = delete;
+    void operator=(const AttackJob&) = delete;
+
+    // runs the blinding, range and lattice phases overlapped
+    // every thread searches for a blinding and runs its range attack as soon as it is found,
+    // a lattice reduction is attempted whenever enough narrow ranges are known, and once it
+    // succeeds no new blindings are searched and the range attacks still running are killed
+    // if no attempt succeeded, the result is calculated from all the ranges at the end
+    void calc_pipelined()
     {
-        std::vector<std::thread> threads;
-        for (int i = 1; i < thread_num; ++i)
-            threads.push_back(std::thread(blinding_thread));
-        blinding_thread();
+        pool.parallel_for(0, pool.size(), [this](size_t) { pipeline_thread(); });
+        finish_blinding = true;
+
+        if (!found_result) calc_result();
+    }
+
+    // runs the attack, in the seeded mode the phases run one after the other and the range attacks
+    // check their pivots sequentially, so the blindings, the ranges and the oracle call counts
+    // don't depend on the timing of the threads
+    void run()
+    {
+        if (!seeded)
+        {
+            calc_pipelined();
+            return;
+        }
+        calc_blindings();
+        calc_ranges();
+        calc_result();
+    }
 
-        for (auto& t : threads)
-            if (t.joinable()) t.join();
+    void calc_blindings()
+    {
+        if (seeded)
+        {
+            pool.parallel_for(0, number_of_blindings, [this](size_t i) { seeded_blinding_job(i); });
+            blindings_found = number_of_blindings;
+        }
+        else
+        {
+            pool.parallel_for(0, pool.size(), [this](size_t) { blinding_thread(); });
+        }
         finish_blinding = true;
     }
 
     void calc_ranges()
     {
-        std::vector<std::thread> threads;
-        for (int i = 1; i < thread_num; ++i)
-            threads.push_back(std::thread(range_thread));
-        range_thread();
-
-        for (auto& t : threads)
-            if (t.joinable()) t.join();
-        current_range = ranges.size();
+        pool.parallel_for(0, number_of_blindings, [this](size_t i) { range_job(i); });
     }
 
     void calc_result()
+    {
+        std::vector<int> indices(number_of_blindings);
+        for (int i = 0; i < number_of_blindings; ++i)
+            indices[i] = i;
+        calc_result(indices);
+    }
+
+    // recovers the message from the ranges of the given blindings
+    // with t_i = s_i / s_0, the offsets x_i = s_i * m - c_i mod n from the middle c_i of the
+    // ranges satisfy x_i = t_i * x_0 + (t_i * c_0 - c_i) mod n, so the lattice contains the short
+    // vector (x_0, ..., x_k, W), all the candidates the reduced basis gives are checked against
+    // the ciphertext
+    // returns true and stores the message in m if it was found
+    bool calc_result(const std::vector<int>& indices)
     {
         using namespace AlgebraTAU;
-        matrix<Fraction> B(number_of_blindings + 1, number_of_blindings + 1, 0);
+        attack_metrics().add(attack_metric::lattice_attempts);
+        scoped_timer timer(attack_metrics(), attack_metric::lattice_time_us);
+        int count = indices.size();
+        matrix<Fraction> B(count + 1, count + 1, 0);
         const Integer& n = srv->publicKey.GetModulus();
         CryptoPP::ModularArithmetic modN = n;
 
-        for (int i = 0; i < number_of_blindings; ++i)
+        Integer s0_inverse = modN.MultiplicativeInverse(blindings[indices[0]]), W = 1;
+        std::vector<Integer> middle(count);
+        for (int i = 0; i < count; ++i)
         {
-            B(0, i) = blindings[i];
-            B(i + 1, i) = n;
-            B(number_of_blindings, i) = ranges[i].first;
+            const II& range = ranges[indices[i]];
+            middle[i] = (range.first + range.second) / 2;
+            W = std::max(W, (range.second - range.first) / 2);
         }
-        B(number_of_blindings, number_of_blindings) =
-        Fraction(n * (number_of_blindings - 1), number_of_blindings);
-        LLL(B, Fraction(3, 4));
 
-        Integer r0 = B(1, 0).round(), a0 = ranges[0].first, s0 = blindings[0];
-        this->m = modN.Multiply(modN.Add(r0, a0), modN.Inverse(s0));
+        B(0, 0) = 1;
+        for (int i = 1; i < count; ++i)
+        {
+            Integer t = modN.Multiply(blindings[indices[i]], s0_inverse);
+            B(0, i) = t;
+            B(i, i) = n;
+            B(count, i) = modN.Subtract(modN.Multiply(t, middle[0]), middle[i]);
+        }
+        B(count, count) = W;
+        {
+            scoped_timer LLL_timer(attack_metrics(), attack_metric::LLL_time_us);
+            LLL_options options;
+            options.cancel = token.get();
+            LLL(B, Fraction(3, 4), options);
+        }
+
+        for (int i = 0; i <= count; ++i)
+        {
+            if (B(i, count) != W && B(i, count) != -W) continue;
+            Integer x0 = B(i, count) == W ? B(i, 0).round() : -B(i, 0).round();
+            Integer candidate = modN.Multiply(modN.Add(x0, middle[0]), s0_inverse);
+            if (srv->publicKey.ApplyFunction(candidate) == *c)
+            {
+                this->m = candidate;
+                return true;
+            }
+        }
+        return false;
     }
 
     std::string get_result() const
     {
         return pkcs_decode(m);
     }
+
+    // the range of the message blinded by the i'th blinding, once calc_ranges ran
+    const II& get_range(int i) const
+    {
+        return ranges[i];
+    }
+};
+
+// runs attacks on a thread pool which is kept between the attacks
+// any number of engines may exist, and any number of jobs may be submitted to an engine at once,
+// the jobs share the workers of the pool
+class AttackEngine
+{
+    AlgebraTAU::thread_pool& pool;
+
+    public:
+    explicit AttackEngine(AlgebraTAU::thread_pool& pool = AlgebraTAU::thread_pool::default_pool())
+    : pool(pool)
+    {
+    }
+
+    // starts an attack on c and returns a future for the decoded message
+    // the future throws std::invalid_argument if the message wasn't recovered, and
+    // operation_cancelled if params.token was cancelled first
+    std::future<std::string> submit(const Server& srv, const Integer& c, const AttackParams& params = AttackParams())
+    {
+        std::shared_ptr<AttackJob> job = std::make_shared<AttackJob>(pool, srv, c, params);
+        return pool.submit([job]() {
+            job->run();
+            return job->get_result();
+        });
+    }
+
+    // waits for a submitted job, the calling thread runs pending tasks in the meantime
+    std::string get(std::future<std::string>& result)
+    {
+        return pool.get(result);
+    }
 };
 
 std::string lap(const std::chrono::steady_clock::time_point& begin)
@@ -558,41 +923,157 @@ std::string lap(const std::chrono::steady_clock::time_point& begin)
     return to_string(hours) + "h" + to_string(minutes) + "m" + to_string(seconds) + "s";
 }
 
+// the tests include this file with BLEICHENBACHER_ATTACK_NO_MAIN defined, to run the attack classes
+#ifndef BLEICHENBACHER_ATTACK_NO_MAIN
 int main(int argc, char* argv[])
 {
     std::streambuf* clogbuf = std::clog.rdbuf();
     ; // save old buf
     std::clog.rdbuf(std::cout.rdbuf()); // redirect std::clog to std::cout to suupport ouput to file
 
-    // setting up server to be attacked
-    Server srv(2048);
-    Integer c = srv.pkcs_encrypt("He11o w0r1d! My n4me is 0fer! This is my secret");
+    // usage: runAttack [--runs N] [--seed S] [--key FILE] [--metrics FILE [--metrics-interval SECONDS]]
+    //                  [--time-limit SECONDS] [--oracle-budget N] [--verbose]
+    // --runs attacks N ciphertexts, each under its own key
+    // --seed makes the keys, the paddings and the blindings deterministic
+    // --key loads the key of all the runs from FILE, or generates it and saves it to FILE
+    // --metrics writes attack_metrics() to FILE at the end, as csv if FILE ends with .csv and as json
+    // otherwise, and also every SECONDS seconds if --metrics-interval is given
+    // --time-limit and --oracle-budget stop every run after SECONDS seconds from its submission or
+    // after N oracle calls
+    // --verbose writes the debug messages of every attacker
+    int runs = 1;
+    AttackParams params;
+    std::string key_path, metrics_path;
+    int metrics_interval = 0;
+    double time_limit = 0;
+    int64_t oracle_budget = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::stoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            params.seeded = true;
+            params.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--key" && i + 1 < argc)
+            key_path = argv[++i];
+        else if (arg == "--metrics" && i + 1 < argc)
+            metrics_path = argv[++i];
+        else if (arg == "--metrics-interval" && i + 1 < argc)
+            metrics_interval = std::stoi(argv[++i]);
+        else if (arg == "--time-limit" && i + 1 < argc)
+            time_limit = std::stod(argv[++i]);
+        else if (arg == "--oracle-budget" && i + 1 < argc)
+            oracle_budget = std::stoll(argv[++i]);
+        else if (arg == "--verbose")
+            Logger::verbose = true;
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--runs N] [--seed S] [--key FILE] "
+                      << "[--metrics FILE [--metrics-interval SECONDS]] [--time-limit SECONDS] "
+                      << "[--oracle-budget N] [--verbose]" << std::endl;
+            return 1;
+        }
+    }
+
+    // setting up servers to be attacked
+    std::unique_ptr<CryptoPP::RandomNumberGenerator> rng;
+    if (params.seeded)
+        rng.reset(new SeededRng(params.seed));
+    else
+        rng.reset(new CryptoPP::AutoSeededRandomPool());
+
+    std::vector<Server> servers;
+    std::vector<Integer> ciphertexts;
+    for (int i = 0; i < runs; ++i)
+    {
+        if (key_path.empty())
+            servers.emplace_back(2048, *rng);
+        else if (i > 0)
+            servers.push_back(servers.front());
+        else if (std::ifstream(key_path).good())
+            servers.emplace_back(key_path);
+        else
+        {
+            servers.emplace_back(2048, *rng);
+            servers.back().save(key_path);
+        }
+        ciphertexts.push_back(servers.back().pkcs_encrypt("He11o w0r1d! My n4me is 0fer! This is my secret", *rng));
+    }
 
     // logging attack beggining
     std::clog << "Main debug: ";
-    std::clog << "keysize=" << srv.publicKey.GetModulus().BitCount();
+    std::clog << "keysize=" << servers.front().publicKey.GetModulus().BitCount();
+    std::clog << ", runs=" << runs;
+    if (params.seeded) std::clog << ", seed=" << params.seed;
     std::clog << ", attacker killed after " << max_message_count << " messages" << std::endl;
 
-    // begining attack
+    // begining attacks, all the jobs share the engine's thread pool
     auto begin_time = std::chrono::steady_clock::now();
-    auto& MTA = MultiThreadAttack::get_instance();
-    MTA.set_params(srv, c, 20);
-    MTA.calc_blindings();
-    MTA.calc_ranges();
-    MTA.calc_result();
-    // outputting the result of the attack
-    try
+
+    // writes the metrics every metrics_interval seconds until the attacks are done
+    auto write_metrics = [&]() {
+        try
+        {
+            attack_metrics().write(metrics_path);
+        }
+        catch (const std::exception& e)
+        {
+            std::clog << "Main debug: failed writing metrics, error " << e.what() << std::endl;
+        }
+    };
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::thread metrics_thread;
+    if (!metrics_path.empty() && metrics_interval > 0)
+        metrics_thread = std::thread([&]() {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            while (!done_cv.wait_for(lock, std::chrono::seconds(metrics_interval), [&]() { return done; }))
+                write_metrics();
+        });
+
+    AttackEngine engine;
+    std::vector<std::future<std::string>> results;
+    for (int i = 0; i < runs; ++i)
     {
-        std::string result = MTA.get_result();
-        std::clog << "Main debug: final result \'" << result << "\"" << std::endl;
+        AttackParams run_params = params;
+        if (time_limit > 0 || oracle_budget > 0)
+        {
+            run_params.token = std::make_shared<AlgebraTAU::cancellation_token>();
+            if (time_limit > 0) run_params.token->set_timeout(std::chrono::duration<double>(time_limit));
+            if (oracle_budget > 0) run_params.token->set_budget(oracle_budget);
+        }
+        results.push_back(engine.submit(servers[i], ciphertexts[i], run_params));
     }
-    catch (const std::exception& e)
+
+    // outputting the results of the attacks
+    for (int i = 0; i < runs; ++i)
     {
-        std::clog << "Main debug: algorithm failed, error " << e.what() << std::endl;
+        try
+        {
+            std::string result = engine.get(results[i]);
+            std::clog << "Main debug: run " << i << " final result \'" << result << "\"" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::clog << "Main debug: run " << i << " algorithm failed, error " << e.what() << std::endl;
+        }
     }
     std::clog << "Main debug: running time " << lap(begin_time) << std::endl;
 
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        done = true;
+    }
+    done_cv.notify_all();
+    if (metrics_thread.joinable()) metrics_thread.join();
+    if (!metrics_path.empty()) write_metrics();
+
     std::clog.rdbuf(clogbuf); // returning std::clog to it's intital position
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
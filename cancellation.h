@@ -0,0 +1,101 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+// thrown by an operation which was stopped through its cancellation_token
+class operation_cancelled : public std::runtime_error
+{
+    public:
+    explicit operation_cancelled(const char* what) : std::runtime_error(what)
+    {
+    }
+};
+
+// cooperative cancellation of long operations
+// a token is cancelled once cancel() was called, its deadline passed or its oracle budget was spent
+// the operations given a token call check() (or spend()) between steps and throw
+// operation_cancelled once it is cancelled, any thread may cancel the token or change its limits
+class cancellation_token
+{
+    typedef std::chrono::steady_clock clock;
+
+    std::atomic_bool cancelled;
+    // the deadline, in ticks of clock since its epoch
+    std::atomic<clock::rep> deadline;
+    // the remaining oracle budget, negative once it was overspent
+    std::atomic<int64_t> budget;
+
+    public:
+    // a token with no deadline and an unlimited budget
+    cancellation_token()
+    : cancelled(false), deadline(std::numeric_limits<clock::rep>::max()),
+      budget(std::numeric_limits<int64_t>::max())
+    {
+    }
+
+    cancellation_token(const cancellation_token&) = delete;
+    cancellation_token& operator=(const cancellation_token&) = delete;
+
+    void cancel()
+    {
+        cancelled = true;
+    }
+
+    void set_deadline(clock::time_point time)
+    {
+        deadline = time.time_since_epoch().count();
+    }
+
+    // sets the deadline to timeout from now
+    template <typename Rep, typename Period>
+    void set_timeout(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        set_deadline(clock::now() + std::chrono::duration_cast<clock::duration>(timeout));
+    }
+
+    // sets the number of oracle calls which may still be spent
+    void set_budget(int64_t calls)
+    {
+        budget = calls;
+    }
+
+    int64_t remaining_budget() const
+    {
+        return budget;
+    }
+
+    bool is_cancelled() const
+    {
+        return cancelled || budget < 0 || clock::now().time_since_epoch().count() > deadline;
+    }
+
+    // throws operation_cancelled if the token is cancelled
+    void check() const
+    {
+        if (cancelled) throw operation_cancelled("operation cancelled");
+        if (budget < 0) throw operation_cancelled("oracle budget exhausted");
+        if (clock::now().time_since_epoch().count() > deadline)
+            throw operation_cancelled("deadline passed");
+    }
+
+    // spends calls from the oracle budget, then calls check()
+    void spend(int64_t calls = 1)
+    {
+        budget -= calls;
+        check();
+    }
+};
+
+} // namespace AlgebraTAU
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef LINEAR_SYSTEM_H
+#define LINEAR_SYSTEM_H
+
+#include <cryptopp/integer.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Fraction.h"
+#include "base.h"
+#include "matrix.h"
+#include "modint.h"
+#include "normal_form.h"
+#include "vector.h"
+
+namespace AlgebraTAU
+{
+
+// replaces m by its reduced row echelon form and returns the columns of its pivots, in order
+// T must be an exact field (Fraction, modint with a prime modulus, static_modint), the entries are
+// compared to zero exactly
+// the rows are updated in parallel when m is large enough
+template <typename T, typename A>
+std::vector<size_t> reduced_row_echelon_form(matrix<T, A>& m)
+{
+    using std::swap;
+
+    const matrix<T, A>& M = m;
+    size_t rows = m.rows(), columns = m.columns();
+    std::vector<size_t> pivots;
+    for (size_t c = 0; c < columns && pivots.size() < rows; ++c)
+    {
+        size_t r = pivots.size(), p = r;
+        while (p < rows && M(p, c) == 0)
+            ++p;
+        if (p == rows) continue;
+        if (p != r)
+            for (size_t j = 0; j < columns; ++j)
+                swap(m(r, j), m(p, j));
+
+        T inverse = T(1) / M(r, c);
+        for (size_t j = c; j < columns; ++j)
+            m(r, j) *= inverse;
+        parallel_for(0, rows, columns - c, [&m, &M, r, c, columns](size_t i) {
+            if (i == r || M(i, c) == 0) return;
+            T factor = M(i, c);
+            for (size_t j = c; j < columns; ++j)
+                m(i, j) -= factor * M(r, j);
+        });
+        pivots.push_back(c);
+    }
+    return pivots;
+}
+
+// multiplies the rows of m by the lcm of the denominators of their entries, which doesn't change
+// the row space of m, and returns the integer result
+template <typename A>
+arena_matrix<CryptoPP::Integer> clear_denominators(const matrix<Fraction, A>& m)
+{
+    using CryptoPP::Integer;
+
+    arena_matrix<Integer> res(m.rows(), m.columns());
+    for (size_t i = 0; i < m.rows(); ++i)
+    {
+        Integer lcm = 1;
+        for (size_t j = 0; j < m.columns(); ++j)
+            lcm *= m(i, j).denominator() / Integer::Gcd(lcm, m(i, j).denominator());
+        for (size_t j = 0; j < m.columns(); ++j)
+            res(i, j) = m(i, j).numerator() * (lcm / m(i, j).denominator());
+    }
+    return res;
+}
+
+// rational matrices are reduced by fraction free elimination of their integer multiple, so the
+// intermediate entries are minors instead of fractions whose size may double with every pivot
+template <typename A>
+std::vector<size_t> reduced_row_echelon_form(matrix<Fraction, A>& m)
+{
+    std::vector<size_t> pivots;
+    scoped_arena scope;
+    arena_matrix<CryptoPP::Integer> M = clear_denominators(m);
+    CryptoPP::Integer d = fraction_free_echelon(M, pivots);
+    for (size_t i = 0; i < m.rows(); ++i)
+        for (size_t j = 0; j < m.columns(); ++j)
+            m(i, j) = i < pivots.size() ? Fraction(M(i, j), d) : Fraction(0);
+    return pivots;
+}
+
+// returns the rank of m, T must be an exact field, see reduced_row_echelon_form
+template <typename T, typename A>
+size_t rank(const matrix<T, A>& m)
+{
+    scoped_arena scope;
+    arena_matrix<T> M(m);
+    return reduced_row_echelon_form(M).size();
+}
+
+template <typename A>
+size_t rank(const matrix<CryptoPP::Integer, A>& m)
+{
+    std::vector<size_t> pivots;
+    scoped_arena scope;
+    arena_matrix<CryptoPP::Integer> M(m);
+    fraction_free_echelon(M, pivots);
+    return pivots.size();
+}
+
+// returns a basis of the kernel of m, the vectors x such that m * x = 0
+// the basis is empty if the columns of m are linearly independent
+// T must be an exact field, see reduced_row_echelon_form
+template <typename T, typename A>
+std::vector<vector<column, T, A>> kernel(const matrix<T, A>& m)
+{
+    matrix<T, A> R = m;
+    std::vector<size_t> pivots = reduced_row_echelon_form(R);
+
+    // every column without a pivot gives a vector, with 1 in its place and minus the column of R in
+    // the places of the pivots
+    std::vector<vector<column, T, A>> res;
+    for (size_t f = 0, r = 0; f < m.columns(); ++f)
+    {
+        if (r < pivots.size() && pivots[r] == f)
+        {
+            ++r;
+            continue;
+        }
+        vector<column, T, A> x(m.columns(), 0);
+        x(f) = 1;
+        for (size_t k = 0; k < r; ++k)
+            x(pivots[k]) = -R(k, f);
+        res.push_back(x);
+    }
+    return res;
+}
+
+// returns a solution of m * x = b by reducing [m | b], the variables of the columns without pivots
+// are set to 0
+// throws std::invalid_argument if m.rows() is not b.size()
+// throws std::domain_error if the system has no solution
+template <typename T, typename A>
+vector<column, T, A> echelon_solve(const matrix<T, A>& m, const vector<column, T, A>& b)
+{
+    size_t rows = m.rows(), columns = m.columns();
+    if (rows != b.size()) throw std::invalid_argument("matrix and vector dimensions doesn't agree");
+
+    matrix<T, A> R(rows, columns + 1);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        for (size_t j = 0; j < columns; ++j)
+            R(i, j) = m(i, j);
+        R(i, columns) = b(i);
+    }
+    std::vector<size_t> pivots = reduced_row_echelon_form(R);
+    if (!pivots.empty() && pivots.back() == columns) throw std::domain_error("system has no solution");
+
+    vector<column, T, A> x(columns, 0);
+    for (size_t r = 0; r < pivots.size(); ++r)
+        x(pivots[r]) = R(r, columns);
+    return x;
+}
+
+// returns a solution of m * x = b, see echelon_solve
+template <typename T, typename A>
+vector<column, T, A> solve(const matrix<T, A>& m, const vector<column, T, A>& b)
+{
+    return echelon_solve(m, b);
+}
+
+// returns the fraction n / d such that n = d * a (mod M) and |n|, 0 < d are at most sqrt(M / 2),
+// which is unique if it exists
+// throws std::domain_error if there is no such fraction
+inline Fraction rational_reconstruction(const CryptoPP::Integer& a, const CryptoPP::Integer& M)
+{
+    using CryptoPP::Integer;
+
+    // the remainders of the euclidean algorithm of M and a, with r_i = t_i * a (mod M)
+    Integer r0 = M, r1 = a % M, t0 = 0, t1 = 1, q, r;
+    while (r1.Squared() * 2 > M)
+    {
+        Integer::Divide(r, q, r0, r1);
+        r0 = r1;
+        r1 = r;
+        r = t0 - q * t1;
+        t0 = t1;
+        t1 = r;
+    }
+    if (t1.Squared() * 2 > M) throw std::domain_error("no rational reconstruction");
+    return Fraction(r1, t1);
+}
+
+// solves the integer system m * x = b by P-adic lifting (Dixon, "Exact solution of linear
+// equations using P-adic expansions"), where bound >= 2 * |n| * d for the solution n / d
+// the inverse of m modulo P is computed once, then every step finds the next P-adic digit of x
+// with a product by the inverse and divides the residual b - m * x by P, so the integers are never
+// larger than bound and the entries of m
+// returns false if m is singular modulo P
+template <uint32_t P, typename A>
+bool dixon_solve(const matrix<CryptoPP::Integer, A>& m,
+                 const std::vector<CryptoPP::Integer>& b,
+                 const CryptoPP::Integer& bound,
+                 std::vector<Fraction>& x)
+{
+    using CryptoPP::Integer;
+    typedef static_modint<P> F;
+
+    size_t n = m.rows();
+    const Integer p = long(P);
+
+    // [m | I] mod P is reduced to [I | C] with C = m^-1 mod P
+    arena_matrix<F> C(n, 2 * n, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+            C(i, j) = (m(i, j) % p).ConvertToLong();
+        C(i, n + i) = 1;
+    }
+    if (reduced_row_echelon_form(C)[n - 1] != n - 1) return false;
+
+    // x = sum of digits x_k * P^k, with x_k = C * r_k (mod P) and r_{k + 1} = (r_k - m * x_k) / P
+    std::vector<Integer> residual = b, digits(n), X(n, Integer::Zero());
+    std::vector<F> r(n);
+    Integer power = 1;
+    while (power <= bound)
+    {
+        for (size_t i = 0; i < n; ++i)
+            r[i] = (residual[i] % p).ConvertToLong();
+        for (size_t i = 0; i < n; ++i)
+        {
+            F digit = 0;
+            for (size_t j = 0; j < n; ++j)
+                digit += C(i, n + j) * r[j];
+            digits[i] = long(digit.value());
+            X[i] += digits[i] * power;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j < n; ++j)
+                residual[i] -= m(i, j) * digits[j];
+            residual[i] /= p;
+        }
+        power *= p;
+    }
+
+    x.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        x[i] = rational_reconstruction(X[i], power);
+    return true;
+}
+
+// square nonsingular rational systems are solved by P-adic lifting of their integer multiple, whose
+// cost grows with the size of the solution rather than with the size of the fractions of an
+// elimination, other systems (and the rare ones which are singular modulo all the primes tried)
+// are solved by echelon_solve
+template <typename A>
+vector<column, Fraction, A> solve(const matrix<Fraction, A>& m, const vector<column, Fraction, A>& b)
+{
+    using CryptoPP::Integer;
+
+    size_t n = m.rows();
+    if (n != b.size()) throw std::invalid_argument("matrix and vector dimensions doesn't agree");
+    if (n != m.columns()) return echelon_solve(m, b);
+
+    scoped_arena scope;
+    arena_matrix<Fraction> system(n, n + 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+            system(i, j) = m(i, j);
+        system(i, n) = b(i);
+    }
+    arena_matrix<Integer> M = clear_denominators(system);
+    arena_matrix<Integer> left(n, n);
+    std::vector<Integer> right(n);
+    // by cramer's rule x_j = det(m_j) / det(m), where m_j is m with b in its j'th column, both are at
+    // most the hadamard bound, the product of the norms of the rows of [m | b]
+    Integer hadamard_squared = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        Integer norm_squared = 0;
+        for (size_t j = 0; j <= n; ++j)
+            norm_squared += M(i, j).Squared();
+        hadamard_squared *= norm_squared;
+        for (size_t j = 0; j < n; ++j)
+            left(i, j) = M(i, j);
+        right[i] = M(i, n);
+    }
+
+    std::vector<Fraction> x;
+    Integer bound = hadamard_squared * 2;
+    if (dixon_solve<2147483647>(left, right, bound, x) || dixon_solve<2147483629>(left, right, bound, x) ||
+        dixon_solve<2147483587>(left, right, bound, x))
+        return vector<column, Fraction, A>(x);
+    return echelon_solve(m, b);
+}
+
+} // namespace AlgebraTAU
+
+#endif
@@ -1,25 +1,43 @@
 #ifndef MARIX_H
 #define MARIX_H
 
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "arena.h"
 #include "base.h"
+#include "cancellation.h"
+#include "storage.h"
+#include "thread_pool.h"
 
 namespace AlgebraTAU
 {
 
 // generative class matrix represents a matrix of type T
-template <typename T>
+// its storage is allocated by A, or is copy on write if A is copy_on_write (see storage.h)
+template <typename T, typename A>
 class matrix
 {
+    template <typename, typename>
+    friend class matrix;
+
     // stores the shape of the matrix
     size_t m_rows, m_columns;
-    // stores the matrix's data - rowise
-    std::vector<T> arr;
+    // stores the matrix's data - rowise, see storage.h
+    typename matrix_storage<T, A>::type arr;
+
+    // constructs a rows x columns matrix with the given storage
+    matrix(size_t rows, size_t columns, typename matrix_storage<T, A>::type&& arr);
 
     public:
     // constructs matrix of shape rows x columns with default value = a
@@ -38,6 +56,10 @@ class matrix
     template <typename T2>
     matrix(const std::vector<std::vector<T2>>& _arr);
 
+    // copies a matrix whose storage is allocated by another allocator
+    template <typename A2>
+    explicit matrix(const matrix<T, A2>& other);
+
     // returns the number of rows in the matrix
     inline size_t rows() const;
     // returns the number of columns in the matrix
@@ -51,7 +73,13 @@ class matrix
     inline T& operator()(size_t i, size_t j);
 
     // returns the transposed matrix
-    matrix transpose() const;
+    // entries are copied (or moved out of an rvalue) straight into place, matrices of trivially
+    // copyable entries are transposed tile by tile by a cache oblivious recursion
+    matrix transpose() const&;
+    matrix transpose() &&;
+    // transposes a square matrix in place, by the same recursion
+    // throws std::domain_error if the matrix is not square
+    void transpose_in_place();
     // maps a function f into the elments of the matrix (elementwise)
     template <typename F>
     void map(const F& f);
@@ -70,23 +98,34 @@ class matrix
 
     // adds two matrices and returns the result
     // throws std::invalid_argument if matrices do not have same shapes
-    matrix operator+(const matrix& other) const;
+    // the overloads taking an rvalue reuse its storage for the result
+    matrix operator+(const matrix& other) const&;
+    matrix operator+(const matrix& other) &&;
+    matrix operator+(matrix&& other) const&;
+    matrix operator+(matrix&& other) &&;
     // adds matrix "other" to "self" and returns reference to "self"
     // throws std::invalid_argument if matrices do not have same shapes
     // addition is done in-place
     matrix& operator+=(const matrix& other);
 
     // negates each element of the matrix
-    matrix operator-() const;
+    matrix operator-() const&;
+    matrix operator-() &&;
     // substracts two matrices and returns the result
     // throws std::invalid_argument if matrices do not have same shapes
-    matrix operator-(const matrix& other) const;
+    // the overloads taking an rvalue reuse its storage for the result
+    matrix operator-(const matrix& other) const&;
+    matrix operator-(const matrix& other) &&;
+    matrix operator-(matrix&& other) const&;
+    matrix operator-(matrix&& other) &&;
     // substracts matrix "other" from "self" and returns reference to "self"
     // substraction is done in-place
     // throws std::invalid_argument if matrices do not have same shapes
     matrix& operator-=(const matrix& other);
 
     // preforms matrix multiplication and returns the result
+    // products whose dimensions are all at least strassen_crossover<T>::value (see base.h) are
+    // computed by strassen-winograd recursion
     // throws std::invalid_argument if matrix shapes do not allow matrix multiplication
     matrix operator*(const matrix& other) const;
     // preforms matrix multiplication and stores result in "self", returns reference to "self"
@@ -96,53 +135,192 @@ class matrix
     // preforms multiplication of self * vec (right matrix-vector multiplication)
     // returns the result as a column vector
     // throws std::invalid_argument if matrix and vector do not allow matrix-vector multiplication
-    vector<column, T> operator*(const vector<column, T>& vec) const;
+    vector<column, T, A> operator*(const vector<column, T, A>& vec) const;
 
     // preforms right scalar multiplication and returns the result
-    matrix operator*(const T& a) const;
+    matrix operator*(const T& a) const&;
+    matrix operator*(const T& a) &&;
     // preforms in-place scalar multiplication, the result is stored in "self"
     // returns reference to self
     matrix& operator*=(const T& a);
 
     // returns the i'th row of the matrix as a row vector
     // throws std::invalid_argument if index is out of range
-    vector<row, T> get_row(int i) const;
+    vector<row, T, A> get_row(int i) const;
 
     // returns the j'th column of the matrix as a column vector
     // throws std::invalid_argument if index is out of range
-    vector<column, T> get_column(int j) const;
+    vector<column, T, A> get_column(int j) const;
 
     // set's the i'th row of the matrix to be some input vector v
     // throws std::invalid_argument if i is out of range
     // throws std::invalid_argument if v.size() is not v.columns()
-    void set_row(int i, const vector<row, T>& v);
+    void set_row(int i, const vector<row, T, A>& v);
 
     // set's the j'th row of the matrix to be some input vector v
     // throws std::invalid_argument if j is out of range
     // throws std::invalid_argument if v.size() is not v.rows()
-    void set_column(int j, const vector<column, T>& v);
+    void set_column(int j, const vector<column, T, A>& v);
+
+    // returns the rows [begin, end) of the matrix as a new matrix
+    // throws std::invalid_argument if the range is empty or out of range
+    matrix get_rows(size_t begin, size_t end) const;
+
+    // copies the rows of m into the rows [begin, begin + m.rows()) of the matrix
+    // throws std::invalid_argument if the range is out of range
+    // throws std::invalid_argument if m.columns() is not columns()
+    void set_rows(size_t begin, const matrix& m);
 };
 
+// a matrix for the temporaries of an algorithm, its storage comes from the current arena of the
+// thread (see arena.h) and is recycled when it is freed within the same scoped_arena
+template <typename T>
+using arena_matrix = matrix<T, arena_allocator<T>>;
+
+// a matrix whose copies share their rows until they are modified, see cow_storage
+template <typename T>
+using cow_matrix = matrix<T, copy_on_write<std::allocator<T>>>;
+
 // read_JSON(std::istream &IS);        // Not implemented
 // write_JSON(std::ostream &OS) const; // Not implemented
 
+// writes the shape and the entries of m (row-wise) into os, see write_binary in base.h
+template <typename T, typename A>
+void write_binary(std::ostream& os, const matrix<T, A>& m);
+
+// reads a matrix written by write_binary from is into m
+// throws std::runtime_error if the stored shape is empty
+template <typename T, typename A>
+void read_binary(std::istream& is, matrix<T, A>& m);
+
 // left scalar multiplication
-template <typename T>
-matrix<T> operator*(const T& b, const matrix<T>& a);
+template <typename T, typename A>
+matrix<T, A> operator*(const T& b, const matrix<T, A>& a);
+template <typename T, typename A>
+matrix<T, A> operator*(const T& b, matrix<T, A>&& a);
 
 // preforms in place, row-wise, gaussian elimination of matrix m
-template <typename T>
-void gaussian_elimination(matrix<T>& m);
+// a column without a pivot is skipped and leaves a zero on the diagonal
+// the rows below the pivots are updated in parallel when m is large enough
+template <typename T, typename A>
+void gaussian_elimination(matrix<T, A>& m);
 
 // preforms in place, row-wise, gram schmidt process of matrix m
-template <typename T>
-void gram_schmidt(matrix<T>& m);
+// linearly dependent rows become zero rows
+template <typename T, typename A>
+void gram_schmidt(matrix<T, A>& m);
+
+// preforms in place, row-wise, gram schmidt process of a k x d matrix m, i.e m = mu * m*
+// mu is set to the k x k lower triangular matrix of the gram schmidt coefficients (with ones on
+// the diagonal) and norms to the squared norms dot(b_i*, b_i*) of the orthogonalised rows
+// linearly dependent rows become zero rows, with zero norms and zero coefficients below them
+// the rows are updated in parallel when m is large enough
+// if gcd_count isn't null, the gcd computations of the process are added to it, on whichever
+// threads they ran (the calling thread may run unrelated tasks while it waits for the rows, so
+// the difference of its gcd_calls counter isn't the count of the process)
+template <typename T, typename A, typename B>
+void gram_schmidt(matrix<T, A>& m,
+                  matrix<T, B>& mu,
+                  std::vector<T>& norms,
+                  size_t* gcd_count = nullptr);
+
+// counters collected during LLL, all of them are accumulated (never reset by LLL)
+struct LLL_stats
+{
+    // number of iterations of the main loop
+    size_t iterations = 0;
+    // number of basis vectors swaps (lovasz condition failures)
+    size_t swaps = 0;
+    // number of size reductions of basis vectors
+    size_t size_reductions = 0;
+    // number of times the gram schmidt basis was recalculated
+    size_t gram_schmidt_calls = 0;
+    // number of gcd computations preformed by the scalar type (see gcd_calls in base.h)
+    size_t gcd_calls = 0;
+    // maximal bit length of an entry of the basis seen during the run
+    size_t max_bit_length = 0;
+    // log2 of the LLL potential, sampled at the beginning, at every progress report and at the end
+    std::vector<double> log_potential;
+
+    // wall time spent in each phase of the algorithm
+    std::chrono::duration<double> gram_schmidt_time{ 0 };
+    std::chrono::duration<double> size_reduction_time{ 0 };
+    std::chrono::duration<double> lovasz_time{ 0 };
+    std::chrono::duration<double> total_time{ 0 };
+
+    // merges the counters of another run into this one
+    LLL_stats& operator+=(const LLL_stats& other);
+};
+
+// optional instrumentation of LLL
+struct LLL_options
+{
+    // if not null, counters of the run are accumulated into stats
+    LLL_stats* stats = nullptr;
+    // if set (and stats is not null), called every progress_interval iterations with the
+    // current stats and the current index k
+    // recursive_LLL calls it only from its final merge pass, so never from two threads at once
+    std::function<void(const LLL_stats&, int)> progress;
+    // 0 disables the periodic reports (and log_potential is then sampled only at the ends of the run)
+    size_t progress_interval = 1000;
+    // if not empty, the full state of the run is written into checkpoint_path whenever
+    // checkpoint_interval passed since the last checkpoint, see LLL_resume
+    std::string checkpoint_path;
+    std::chrono::duration<double> checkpoint_interval{ 60 };
+    // if not null, checked before every iteration, the run throws operation_cancelled once it is
+    // cancelled and m is left as a basis of the same lattice, reduced up to the current row
+    const cancellation_token* cancel = nullptr;
+};
 
 // preforms LLL over matrix m with size paremeter delta
 // assumes m is a row-wise base matrix
 // result is stored in m but not all calculations is done in place
-template <typename T>
-void LLL(matrix<T>& m, const T& delta);
+template <typename T, typename A>
+void LLL(matrix<T, A>& m, const T& delta, const LLL_options& options = {});
+
+// the main loop of LLL, starting from row k
+// assumes rows [0, k) of m are already LLL reduced (as a lattice of their own)
+template <typename T, typename A>
+void LLL_reduce(matrix<T, A>& m, const T& delta, int k, const LLL_options& options = {});
+
+// continues an LLL run from the checkpoint file at path, exactly where it was written
+// the reduced basis is stored in m, delta is taken from the checkpoint
+// the counters of the checkpoint are added to options.stats, if given
+// unless options.checkpoint_path is set, the run keeps checkpointing into path
+// throws std::runtime_error if the file can't be read or isn't a valid checkpoint
+template <typename T, typename A>
+void LLL_resume(matrix<T, A>& m, const std::string& path, const LLL_options& options = {});
+
+// preforms recursive LLL over matrix m with size paremeter delta
+// the halves of the basis are reduced independently, in parallel on the default thread pool, and
+// then merged
+// blocks of at most 2 * block_size rows are reduced directly by LLL
+// the stats of the halves are merged into options.stats, but options.progress is called and the
+// checkpoints are written only by the final merge pass, so a checkpoint always holds the whole basis
+// throws std::invalid_argument if block_size == 0
+template <typename T, typename A>
+void recursive_LLL(matrix<T, A>& m,
+                   const T& delta,
+                   size_t block_size = 8,
+                   const LLL_options& options = {});
+
+// preforms LLL over the lattice whose gram matrix is G, i.e G = B * B^T for a row-wise basis B
+// only G and the unimodular transform are updated, the basis itself is never used
+// G is replaced by the gram matrix of the reduced basis
+// returns the unimodular transform U such that U * B is the reduced basis
+// checkpointing is not supported, the rest of the options are as in LLL
+// throws std::domain_error if G is not square or the basis is linearly dependent
+template <typename T, typename A>
+matrix<T, A> gram_LLL(matrix<T, A>& G, const T& delta, const LLL_options& options = {});
+
+// preforms LLL over matrix m using gram_LLL, the transform is applied to m once at the end
+// much cheaper than LLL when m has many more columns than rows
+template <typename T, typename A>
+void LLL_via_gram(matrix<T, A>& m, const T& delta, const LLL_options& options = {});
+
+// checks if m is size reduced and satisfies the lovasz condition with paremeter delta
+template <typename T, typename A>
+bool is_LLL_reduced(const matrix<T, A>& m, const T& delta);
 
 } // namespace AlgebraTAU
 
@@ -2,14 +2,20 @@
 namespace AlgebraTAU
 {
 
-template <typename T>
-matrix<T> operator*(const T& b, const matrix<T>& a)
+template <typename T, typename A>
+matrix<T, A> operator*(const T& b, const matrix<T, A>& a)
 {
     return a * b;
 }
 
-template <typename T>
-vector<row, T> matrix<T>::get_row(int i) const
+template <typename T, typename A>
+matrix<T, A> operator*(const T& b, matrix<T, A>&& a)
+{
+    return std::move(a) * b;
+}
+
+template <typename T, typename A>
+vector<row, T, A> matrix<T, A>::get_row(int i) const
 {
     if (i > rows()) throw std::invalid_argument("index out of range");
 
@@ -19,8 +25,8 @@ vector<row, T> matrix<T>::get_row(int i) const
     return res;
 }
 
-template <typename T>
-vector<column, T> matrix<T>::get_column(int j) const
+template <typename T, typename A>
+vector<column, T, A> matrix<T, A>::get_column(int j) const
 {
     if (j > columns()) throw std::invalid_argument("index out of range");
 
@@ -30,8 +36,8 @@ vector<column, T> matrix<T>::get_column(int j) const
     return res;
 }
 
-template <typename T>
-void matrix<T>::set_row(int i, const vector<row, T>& v)
+template <typename T, typename A>
+void matrix<T, A>::set_row(int i, const vector<row, T, A>& v)
 {
     if (i > rows()) throw std::invalid_argument("index out of range");
 
@@ -42,8 +48,8 @@ void matrix<T>::set_row(int i, const vector<row, T>& v)
         self(i, j) = v(j);
 }
 
-template <typename T>
-void matrix<T>::set_column(int j, const vector<column, T>& v)
+template <typename T, typename A>
+void matrix<T, A>::set_column(int j, const vector<column, T, A>& v)
 {
     if (j > columns()) throw std::invalid_argument("index out of range");
 
@@ -54,25 +60,98 @@ void matrix<T>::set_column(int j, const vector<column, T>& v)
         self(i, j) = v(j);
 }
 
-template <typename T>
-void gram_schmidt(matrix<T>& m)
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::get_rows(size_t begin, size_t end) const
 {
-    if (m.rows() != m.columns())
-        throw std::domain_error("can't preform gram_schmidt on non-square matrix");
+    if (begin >= end || end > rows()) throw std::invalid_argument("index out of range");
 
-    for (int i = 1; i < m.rows(); ++i)
+    matrix<T, A> res(end - begin, columns());
+    for (size_t i = begin; i < end; ++i)
+        for (size_t j = 0; j < columns(); ++j)
+            res(i - begin, j) = self(i, j);
+    return res;
+}
+
+template <typename T, typename A>
+void matrix<T, A>::set_rows(size_t begin, const matrix& m)
+{
+    if (begin + m.rows() > rows()) throw std::invalid_argument("index out of range");
+
+    if (m.columns() != columns()) throw std::invalid_argument("matrix dimensions doesn't agree");
+
+    for (size_t i = 0; i < m.rows(); ++i)
+        for (size_t j = 0; j < columns(); ++j)
+            self(begin + i, j) = m(i, j);
+}
+
+// calls f(i) for every i in [begin, end)
+// if the total work, (end - begin) * cost, is large enough the range is split between the workers
+// of the default thread pool
+template <typename F>
+void parallel_for(size_t begin, size_t end, size_t cost, const F& f)
+{
+    const size_t parallel_threshold = 1 << 14;
+    thread_pool& pool = thread_pool::default_pool();
+    if (end <= begin + 1 || pool.size() == 1 || (end - begin) * cost < parallel_threshold)
     {
-        vector<row, T> v = m.get_row(i), s(m.columns(), 0);
-        for (int j = 0; j < i; ++j)
-        {
-            s += project(v, m.get_row(j));
-        }
-        m.set_row(i, v - s);
+        for (size_t i = begin; i < end; ++i)
+            f(i);
+        return;
     }
+    pool.parallel_for(begin, end, f);
 }
 
-template <typename T>
-bool is_upper_triangular(const matrix<T>& m)
+template <typename T, typename A>
+void gram_schmidt(matrix<T, A>& m)
+{
+    scoped_arena scope;
+    arena_matrix<T> mu(m.rows(), m.rows());
+    std::vector<T> norms;
+    gram_schmidt(m, mu, norms);
+}
+
+// modified gram schmidt, right looking: once b_j* is final it is projected out of all the rows
+// below it, those updates are independent so they are split between threads
+// the gcd computations are counted by the thread which runs every row update, around the update
+template <typename T, typename A, typename B>
+void gram_schmidt(matrix<T, A>& m, matrix<T, B>& mu, std::vector<T>& norms, size_t* gcd_count)
+{
+    size_t rows = m.rows(), columns = m.columns();
+    mu = matrix<T, B>(rows, rows, 0);
+    norms.assign(rows, 0);
+    std::atomic<size_t> gcds(0);
+
+    for (size_t j = 0; j < rows; ++j)
+    {
+        size_t gcds_before = gcd_calls(norms[j]);
+        mu(j, j) = 1;
+        for (size_t t = 0; t < columns; ++t)
+            norms[j] += m(j, t) * m(j, t);
+        if (gcd_count) gcds += gcd_calls(norms[j]) - gcds_before;
+        if (norms[j] == 0) continue;
+
+        // row j is only read, through b_j, while the rows below it are updated
+        const matrix<T, A>& b_j = m;
+        parallel_for(j + 1, rows, columns,
+                     [&m, &b_j, &mu, &norms, &gcds, gcd_count, j, columns](size_t i) {
+                         size_t gcds_before = gcd_calls(norms[j]);
+                         T d = 0;
+                         for (size_t t = 0; t < columns; ++t)
+                             d += m(i, t) * b_j(j, t);
+                         if (d != 0)
+                         {
+                             mu(i, j) = d / norms[j];
+                             for (size_t t = 0; t < columns; ++t)
+                                 m(i, t) -= mu(i, j) * b_j(j, t);
+                         }
+                         if (gcd_count) gcds += gcd_calls(norms[j]) - gcds_before;
+                     });
+    }
+    if (gcd_count) *gcd_count += gcds;
+}
+
+template <typename T, typename A>
+bool is_upper_triangular(const matrix<T, A>& m)
 {
     for (int i = 0; i < m.rows(); ++i)
         for (int j = 0; j < i && j < m.columns(); ++j)
@@ -80,8 +159,8 @@ bool is_upper_triangular(const matrix<T>& m)
     return true;
 };
 
-template <typename T>
-bool is_lower_triangular(const matrix<T>& m)
+template <typename T, typename A>
+bool is_lower_triangular(const matrix<T, A>& m)
 {
     for (int i = 0; i < m.rows(); ++i)
         for (int j = i + 1; j < m.columns(); ++j)
@@ -89,20 +168,20 @@ bool is_lower_triangular(const matrix<T>& m)
     return true;
 }
 
-template <typename T>
-vector<column, T> matrix<T>::operator*(const vector<column, T>& vec) const
+template <typename T, typename A>
+vector<column, T, A> matrix<T, A>::operator*(const vector<column, T, A>& vec) const
 {
     if (columns() != vec.size())
         throw std::invalid_argument("matrix and vector dimensions doesn't agree");
-    vector<column, T> res(rows(), true, 0);
+    vector<column, T, A> res(rows(), 0);
     for (int i = 0; i < rows(); ++i)
         for (int j = 0; j < columns(); ++j)
             res(i) += self(i, j) * vec(j);
     return res;
 }
 
-template <typename T>
-matrix<T>& matrix<T>::operator+=(const matrix& other)
+template <typename T, typename A>
+matrix<T, A>& matrix<T, A>::operator+=(const matrix& other)
 {
     if (columns() != other.columns() || rows() != other.rows())
         throw std::invalid_argument("matrixes must have same shapes");
@@ -112,8 +191,8 @@ matrix<T>& matrix<T>::operator+=(const matrix& other)
     return self;
 }
 
-template <typename T>
-matrix<T> matrix<T>::operator+(const matrix& other) const
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator+(const matrix& other) const&
 {
     if (columns() != other.columns() || rows() != other.rows())
         throw std::invalid_argument("matrixes must have same shapes");
@@ -122,8 +201,29 @@ matrix<T> matrix<T>::operator+(const matrix& other) const
     return res;
 }
 
-template <typename T>
-matrix<T>& matrix<T>::operator-=(const matrix& other)
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator+(const matrix& other) &&
+{
+    self += other;
+    return std::move(self);
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator+(matrix&& other) const&
+{
+    other += self;
+    return std::move(other);
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator+(matrix&& other) &&
+{
+    self += other;
+    return std::move(self);
+}
+
+template <typename T, typename A>
+matrix<T, A>& matrix<T, A>::operator-=(const matrix& other)
 {
     if (columns() != other.columns() || rows() != other.rows())
         throw std::invalid_argument("matrixes must have same shapes");
@@ -133,18 +233,24 @@ matrix<T>& matrix<T>::operator-=(const matrix& other)
     return self;
 }
 
-template <typename T>
-matrix<T> matrix<T>::operator-() const
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-() const&
 {
     auto res = self;
+    return -std::move(res);
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-() &&
+{
     for (int i = 0; i < rows(); ++i)
         for (int j = 0; j < columns(); ++j)
-            res(i, j) = -res(i, j);
-    return res;
+            self(i, j) = -self(i, j);
+    return std::move(self);
 }
 
-template <typename T>
-matrix<T> matrix<T>::operator-(const matrix& other) const
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-(const matrix& other) const&
 {
     if (columns() != other.columns() || rows() != other.rows())
         throw std::invalid_argument("matrixes must have same shapes");
@@ -153,8 +259,33 @@ matrix<T> matrix<T>::operator-(const matrix& other) const
     return res;
 }
 
-template <typename T>
-matrix<T>& matrix<T>::operator*=(const T& a)
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-(const matrix& other) &&
+{
+    self -= other;
+    return std::move(self);
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-(matrix&& other) const&
+{
+    if (columns() != other.columns() || rows() != other.rows())
+        throw std::invalid_argument("matrixes must have same shapes");
+    for (int i = 0; i < rows(); ++i)
+        for (int j = 0; j < columns(); ++j)
+            other(i, j) = self(i, j) - other(i, j);
+    return std::move(other);
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator-(matrix&& other) &&
+{
+    self -= other;
+    return std::move(self);
+}
+
+template <typename T, typename A>
+matrix<T, A>& matrix<T, A>::operator*=(const T& a)
 {
     for (int i = 0; i < rows(); ++i)
         for (int j = 0; j < columns(); ++j)
@@ -162,85 +293,633 @@ matrix<T>& matrix<T>::operator*=(const T& a)
     return self;
 }
 
+// adds the classical product of the blocks a[rows] x b[columns] into res, where rows and columns
+// are ranges [begin, end) of the rows of a and of the columns of b
+// the rows of b are traversed in order, and every entry of res still accumulates its terms in the
+// order of the inner dimension
+template <typename T, typename A, typename B, typename C>
+void multiply_add(const matrix<T, A>& a,
+                  const matrix<T, B>& b,
+                  matrix<T, C>& res,
+                  size_t rows_begin,
+                  size_t rows_end,
+                  size_t columns_begin,
+                  size_t columns_end)
+{
+    for (size_t i = rows_begin; i < rows_end; ++i)
+        for (size_t k = 0; k < a.columns(); ++k)
+        {
+            const T& x = a(i, k);
+            for (size_t j = columns_begin; j < columns_end; ++j)
+                res(i, j) += x * b(k, j);
+        }
+}
+
+// returns the rows x columns block of m whose top left entry is m(i, j)
 template <typename T>
-matrix<T> matrix<T>::operator*(const matrix& other) const
+arena_matrix<T> get_block(const arena_matrix<T>& m, size_t i, size_t j, size_t rows, size_t columns)
 {
-    if (columns() != other.rows()) throw std::invalid_argument("matrixes dimensions don't agree");
-    matrix<T> res(rows(), other.columns(), 0);
-    for (int i = 0; i < rows(); ++i)
-        for (int j = 0; j < other.columns(); ++j)
-            for (int k = 0; k < columns(); ++k)
-                res(i, j) += self(i, k) * other(k, j);
+    arena_matrix<T> res(rows, columns);
+    for (size_t r = 0; r < rows; ++r)
+        for (size_t c = 0; c < columns; ++c)
+            res(r, c) = m(i + r, j + c);
     return res;
 }
 
+// copies block into m, with its top left entry at m(i, j)
 template <typename T>
-matrix<T>& matrix<T>::operator*=(const matrix& other)
+void set_block(arena_matrix<T>& m, size_t i, size_t j, const arena_matrix<T>& block)
+{
+    for (size_t r = 0; r < block.rows(); ++r)
+        for (size_t c = 0; c < block.columns(); ++c)
+            m(i + r, j + c) = block(r, c);
+}
+
+// the product a * b by strassen-winograd recursion, 7 products and 15 sums of half size blocks
+// (Winograd's variant of Strassen's algorithm)
+// odd dimensions are peeled: the recursion multiplies the even leading blocks, and the last row of
+// a, the last column of b and the last term of the inner dimension are added classically
+// the blocks are arena matrices, so must be called within a scoped_arena
+template <typename T>
+arena_matrix<T> strassen_winograd(const arena_matrix<T>& a, const arena_matrix<T>& b)
+{
+    size_t m = a.rows(), k = a.columns(), n = b.columns();
+    arena_matrix<T> res(m, n, 0);
+    const size_t crossover = strassen_crossover<T>::value;
+    if (std::min(std::min(m, k), n) < std::max<size_t>(crossover, 2))
+    {
+        multiply_add(a, b, res, 0, m, 0, n);
+        return res;
+    }
+
+    size_t h = m / 2, l = k / 2, w = n / 2;
+    arena_matrix<T> a11 = get_block(a, 0, 0, h, l), a12 = get_block(a, 0, l, h, l),
+                    a21 = get_block(a, h, 0, h, l), a22 = get_block(a, h, l, h, l);
+    arena_matrix<T> b11 = get_block(b, 0, 0, l, w), b12 = get_block(b, 0, w, l, w),
+                    b21 = get_block(b, l, 0, l, w), b22 = get_block(b, l, w, l, w);
+
+    arena_matrix<T> s1 = a21 + a22;
+    arena_matrix<T> s2 = s1 - a11;
+    arena_matrix<T> s3 = a11 - a21;
+    arena_matrix<T> s4 = a12 - s2;
+    arena_matrix<T> t1 = b12 - b11;
+    arena_matrix<T> t2 = b22 - t1;
+    arena_matrix<T> t3 = b22 - b12;
+    arena_matrix<T> t4 = t2 - b21;
+
+    arena_matrix<T> p1 = strassen_winograd(a11, b11);
+    arena_matrix<T> u2 = p1 + strassen_winograd(s2, t2);
+    arena_matrix<T> u3 = u2 + strassen_winograd(s3, t3);
+    arena_matrix<T> p5 = strassen_winograd(s1, t1);
+    set_block(res, 0, 0, p1 + strassen_winograd(a12, b21));
+    set_block(res, 0, w, u2 + p5 + strassen_winograd(s4, b22));
+    set_block(res, h, 0, u3 - strassen_winograd(a22, t4));
+    set_block(res, h, w, std::move(u3) + p5);
+
+    // the last term of the inner dimension of the leading block
+    if (k % 2)
+        for (size_t i = 0; i < 2 * h; ++i)
+        {
+            const T& x = a(i, k - 1);
+            for (size_t j = 0; j < 2 * w; ++j)
+                res(i, j) += x * b(k - 1, j);
+        }
+    if (n % 2) multiply_add(a, b, res, 0, 2 * h, n - 1, n);
+    if (m % 2) multiply_add(a, b, res, m - 1, m, 0, n);
+    return res;
+}
+
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator*(const matrix& other) const
+{
+    if (columns() != other.rows()) throw std::invalid_argument("matrixes dimensions don't agree");
+    const size_t crossover = strassen_crossover<T>::value;
+    matrix<T, A> res(rows(), other.columns(), 0);
+    if (std::min(std::min(rows(), columns()), other.columns()) < std::max<size_t>(crossover, 2))
+    {
+        multiply_add(self, other, res, 0, rows(), 0, other.columns());
+        return res;
+    }
+
+    // res is allocated outside the scope, it may be an arena matrix of the caller
+    scoped_arena scope;
+    arena_matrix<T> product = strassen_winograd(arena_matrix<T>(self), arena_matrix<T>(other));
+    for (size_t i = 0; i < rows(); ++i)
+        for (size_t j = 0; j < other.columns(); ++j)
+            res(i, j) = std::move(product(i, j));
+    return res;
+}
+
+template <typename T, typename A>
+matrix<T, A>& matrix<T, A>::operator*=(const matrix& other)
 {
     if (columns() != other.rows()) throw std::invalid_argument("matrixes dimensions don't agree");
     self = self * other;
     return self;
 }
 
-template <typename T>
-matrix<T> matrix<T>::operator*(const T& a) const
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator*(const T& a) const&
 {
     auto res = self;
     res *= a;
     return res;
 }
 
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::operator*(const T& a) &&
+{
+    self *= a;
+    return std::move(self);
+}
+
 // The algorithm as described in
 // https://en.wikipedia.org/wiki/Lenstra%E2%80%93Lenstra%E2%80%93Lov%C3%A1sz_lattice_basis_reduction_algorithm
+template <typename T, typename A>
+void LLL(matrix<T, A>& m, const T& delta, const LLL_options& options)
+{
+    LLL_reduce(m, delta, 1, options);
+}
+
+inline LLL_stats& LLL_stats::operator+=(const LLL_stats& other)
+{
+    iterations += other.iterations;
+    swaps += other.swaps;
+    size_reductions += other.size_reductions;
+    gram_schmidt_calls += other.gram_schmidt_calls;
+    gcd_calls += other.gcd_calls;
+    max_bit_length = std::max(max_bit_length, other.max_bit_length);
+    log_potential.insert(log_potential.end(), other.log_potential.begin(), other.log_potential.end());
+    gram_schmidt_time += other.gram_schmidt_time;
+    size_reduction_time += other.size_reduction_time;
+    lovasz_time += other.lovasz_time;
+    total_time += other.total_time;
+    return *this;
+}
+
+// returns log2 of the LLL potential of the basis, i.e the sum of (n - i) * log2(|b_i*|^2)
 template <typename T>
-void LLL(matrix<T>& m, const T& delta)
+double log_potential(const std::vector<T>& norms)
+{
+    using std::log2;
+
+    double res = 0;
+    for (size_t i = 0; i < norms.size(); ++i)
+        res += (norms.size() - i) * log2(norms[i]);
+    return res;
+}
+
+// returns the maximal bit length of the entries of the i'th row of m
+template <typename T, typename A>
+size_t max_bit_length(const matrix<T, A>& m, int i)
+{
+    size_t res = 0;
+    for (int j = 0; j < m.columns(); ++j)
+        res = std::max(res, bit_length(m(i, j)));
+    return res;
+}
+
+// the main loop of LLL, starting from row k
+// rows [0, k) of m must already be LLL reduced
+// the gram schmidt temporaries of the run are allocated from an arena of their own
+template <typename T, typename A>
+void LLL_reduce(matrix<T, A>& m, const T& delta, int k, const LLL_options& options)
+{
+    scoped_arena scope;
+    arena_matrix<T> mu(m.rows(), m.rows());
+    std::vector<T> norms;
+    LLL_main_loop(m, mu, norms, delta, k, options, false);
+}
+
+template <typename T, typename A>
+void LLL_resume(matrix<T, A>& m, const std::string& path, const LLL_options& options)
 {
+    T delta;
+    int k;
+    LLL_stats saved;
+    scoped_arena scope;
+    arena_matrix<T> mu(m);
+    std::vector<T> norms;
+    read_LLL_checkpoint(path, m, mu, norms, delta, k, saved);
+    if (options.stats) *options.stats += saved;
+
+    LLL_options resumed_options = options;
+    if (resumed_options.checkpoint_path.empty()) resumed_options.checkpoint_path = path;
+    LLL_main_loop(m, mu, norms, delta, k, resumed_options, true);
+}
 
+// checkpoint file layout (native byte order):
+// magic, version, k, the integer counters of LLL_stats, delta, basis,
+// gram schmidt coefficients, gram schmidt squared norms
+const uint32_t LLL_checkpoint_magic = 0x4c4c4c43; // "LLLC"
+const uint32_t LLL_checkpoint_version = 2;
+
+// writes the full LLL state into path
+// the state is first written into a temporary file which then replaces path, so a crash while
+// writing leaves the previous checkpoint intact
+template <typename T, typename A, typename B>
+void write_LLL_checkpoint(const std::string& path,
+                          const matrix<T, A>& m,
+                          const matrix<T, B>& mu,
+                          const std::vector<T>& norms,
+                          const T& delta,
+                          int k,
+                          const LLL_stats& stats)
+{
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+        write_binary(os, LLL_checkpoint_magic);
+        write_binary(os, LLL_checkpoint_version);
+        write_binary(os, int64_t(k));
+        for (size_t counter : { stats.iterations, stats.swaps, stats.size_reductions,
+                                stats.gram_schmidt_calls, stats.gcd_calls, stats.max_bit_length })
+            write_binary(os, uint64_t(counter));
+        write_binary(os, delta);
+        write_binary(os, m);
+        write_binary(os, mu);
+        for (const T& norm : norms)
+            write_binary(os, norm);
+        if (!os) throw std::runtime_error("failed writing LLL checkpoint " + tmp_path);
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("failed replacing LLL checkpoint " + path);
+}
+
+// reads an LLL state written by write_LLL_checkpoint
+template <typename T, typename A, typename B>
+void read_LLL_checkpoint(const std::string& path,
+                         matrix<T, A>& m,
+                         matrix<T, B>& mu,
+                         std::vector<T>& norms,
+                         T& delta,
+                         int& k,
+                         LLL_stats& stats)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is) throw std::runtime_error("can't open LLL checkpoint " + path);
+
+    uint32_t magic, version;
+    int64_t index;
+    read_binary(is, magic);
+    read_binary(is, version);
+    if (!is || magic != LLL_checkpoint_magic || version != LLL_checkpoint_version)
+        throw std::runtime_error("invalid LLL checkpoint " + path);
+    read_binary(is, index);
+    k = index;
+
+    for (size_t* counter : { &stats.iterations, &stats.swaps, &stats.size_reductions,
+                             &stats.gram_schmidt_calls, &stats.gcd_calls, &stats.max_bit_length })
+    {
+        uint64_t value;
+        read_binary(is, value);
+        *counter = value;
+    }
+
+    read_binary(is, delta);
+    read_binary(is, m);
+    read_binary(is, mu);
+    norms.assign(m.rows(), 0);
+    for (T& norm : norms)
+        read_binary(is, norm);
+    if (!is) throw std::runtime_error("truncated LLL checkpoint " + path);
+    if (mu.rows() != m.rows() || mu.columns() != m.rows() || k < 1 || k > m.rows())
+        throw std::runtime_error("invalid LLL checkpoint " + path);
+}
+
+// the main loop of LLL, starting from row k
+// mu and norms are the gram schmidt coefficients and squared norms of m
+// if resumed is false they are calculated before the loop
+// size reductions update mu in place, only swaps recalculate the gram schmidt decomposition
+template <typename T, typename A, typename B>
+void LLL_main_loop(matrix<T, A>& m,
+                   matrix<T, B>& mu,
+                   std::vector<T>& norms,
+                   const T& delta,
+                   int k,
+                   const LLL_options& options,
+                   bool resumed)
+{
     using std::abs;
+    using std::round;
+    typedef std::chrono::steady_clock clock;
+
+    bool checkpointing = !options.checkpoint_path.empty();
+    // the counters are part of the checkpoint, so they are collected even if no stats were asked
+    LLL_stats local_stats;
+    LLL_stats* stats = options.stats ? options.stats : checkpointing ? &local_stats : nullptr;
+    clock::time_point begin_time = clock::now(), phase_time, checkpoint_time = begin_time;
+    size_t gcd_calls_before = gcd_calls(delta);
 
     int n = m.rows() - 1;
     int dim = m.columns();
-    // TODO fix!
-    vector<row, T> vec(dim, 0);
-    matrix<T> ortho = m;
-    gram_schmidt(ortho);
+    T q;
+
+    auto orthogonalize = [&]() {
+        if (stats) phase_time = clock::now();
+        arena_matrix<T> ortho(m);
+        // gram_schmidt counts its own gcd calls, the calls this thread made meanwhile may belong to
+        // the tasks of other operations it ran while waiting for the rows, so they are skipped
+        size_t gcd_calls_outside = gcd_calls(delta);
+        gram_schmidt(ortho, mu, norms, stats ? &stats->gcd_calls : nullptr);
+        gcd_calls_before += gcd_calls(delta) - gcd_calls_outside;
+        if (stats)
+        {
+            ++stats->gram_schmidt_calls;
+            stats->gram_schmidt_time += clock::now() - phase_time;
+        }
+    };
 
-    auto mu = [&m, &ortho](int i, int j) {
-        return dot(m.get_row(i), ortho.get_row(j)) / dot(ortho.get_row(j), ortho.get_row(j));
+    auto report = [&]() {
+        if (stats == nullptr) return;
+        stats->gcd_calls += gcd_calls(delta) - gcd_calls_before;
+        gcd_calls_before = gcd_calls(delta);
+        stats->log_potential.push_back(log_potential(norms));
+        if (options.progress) options.progress(*stats, k);
     };
 
-    int k = 1;
+    if (!resumed)
+    {
+        orthogonalize();
+        if (stats)
+            for (int i = 0; i <= n; ++i)
+                stats->max_bit_length = std::max(stats->max_bit_length, max_bit_length(m, i));
+    }
+    report();
+
+    k = std::max(k, 1);
     while (k <= n)
     {
+        if (options.cancel) options.cancel->check();
+        if (checkpointing && clock::now() - checkpoint_time >= options.checkpoint_interval)
+        {
+            stats->gcd_calls += gcd_calls(delta) - gcd_calls_before;
+            gcd_calls_before = gcd_calls(delta);
+            write_LLL_checkpoint(options.checkpoint_path, m, mu, norms, delta, k, *stats);
+            checkpoint_time = clock::now();
+        }
+
+        if (stats)
+        {
+            ++stats->iterations;
+            if (options.progress_interval != 0 && stats->iterations % options.progress_interval == 0)
+                report();
+            phase_time = clock::now();
+        }
+
+        bool reduced = false;
         for (int j = k - 1; j >= 0; --j)
         {
             if (2 * abs(mu(k, j)) > 1)
             {
-                m.set_row(k, m.get_row(k) - T(round(mu(k, j))) * m.get_row(j));
-                ortho = m;
-                gram_schmidt(ortho);
+                // b_k <- b_k - q * b_j, which leaves b_k* unchanged
+                q = T(round(mu(k, j)));
+                for (int t = 0; t < dim; ++t)
+                    m(k, t) -= q * m(j, t);
+                for (int t = 0; t <= j; ++t)
+                    mu(k, t) -= q * mu(j, t);
+                if (stats) ++stats->size_reductions;
+                reduced = true;
             }
         }
+        if (stats)
+        {
+            stats->size_reduction_time += clock::now() - phase_time;
+            if (reduced) stats->max_bit_length = std::max(stats->max_bit_length, max_bit_length(m, k));
+            phase_time = clock::now();
+        }
 
-        if (ortho.get_row(k).norm() >= (delta - sqaure(mu(k, k - 1))) * ortho.get_row(k - 1).norm())
+        if (norms[k] >= (delta - sqaure(mu(k, k - 1))) * norms[k - 1])
         {
             k = k + 1;
+            if (stats) stats->lovasz_time += clock::now() - phase_time;
         }
         else
         {
-            vec = m.get_row(k);
-            m.set_row(k, m.get_row(k - 1));
-            m.set_row(k - 1, vec);
-            ortho = m;
-            gram_schmidt(ortho);
+            for (int t = 0; t < dim; ++t)
+                std::swap(m(k, t), m(k - 1, t));
+            if (stats)
+            {
+                ++stats->swaps;
+                stats->lovasz_time += clock::now() - phase_time;
+            }
+            orthogonalize();
 
             k = std::max(k - 1, 1);
         }
     }
+
+    if (stats)
+    {
+        report();
+        stats->total_time += clock::now() - begin_time;
+    }
 }
 
-template <typename T>
-T dot(const matrix<T>& a, const matrix<T>& b)
+// Splits the basis into two halves of rows, reduces each half (in parallel) as a lattice of its
+// own, and merges them by running the LLL main loop from the first row of the second half.
+// Reducing the halves first shortens the rows of the second half, so the merging pass starts
+// from a much better conditioned basis than the original one.
+template <typename T, typename A>
+void recursive_LLL(matrix<T, A>& m, const T& delta, size_t block_size, const LLL_options& options)
+{
+    if (block_size == 0) throw std::invalid_argument("block size must be positive");
+    if (m.rows() <= 2 * block_size)
+    {
+        LLL(m, delta, options);
+        return;
+    }
+
+    size_t mid = m.rows() / 2;
+    matrix<T, A> top = m.get_rows(0, mid), bottom = m.get_rows(mid, m.rows());
+
+    // the halves are reduced on different threads, so each one collects its own stats, and only the
+    // merge pass reports progress, so the callback is never called from two threads at once
+    LLL_stats top_stats, bottom_stats;
+    LLL_options top_options = options, bottom_options = options;
+    top_options.progress = bottom_options.progress = nullptr;
+    // a checkpoint must hold the whole basis, the halves would overwrite each other's checkpoints
+    // and a resumed run would reduce the lattice of a half, so only the merge pass checkpoints
+    top_options.checkpoint_path.clear();
+    bottom_options.checkpoint_path.clear();
+    if (options.stats)
+    {
+        top_options.stats = &top_stats;
+        bottom_options.stats = &bottom_stats;
+    }
+
+    thread_pool::default_pool().parallel_for(0, 2, [&](size_t half) {
+        if (half == 0)
+            recursive_LLL(top, delta, block_size, top_options);
+        else
+            recursive_LLL(bottom, delta, block_size, bottom_options);
+    });
+    if (options.stats)
+    {
+        *options.stats += top_stats;
+        *options.stats += bottom_stats;
+    }
+
+    m.set_rows(0, top);
+    m.set_rows(mid, bottom);
+    LLL_reduce(m, delta, mid, options);
+}
+
+// LLL over the gram matrix, as described in Henri Cohen's "A Course in Computational Algebraic
+// Number Theory" (algorithm 2.6.3 and its gram matrix variant 2.6.7).
+// The gram schmidt coefficients and norms are updated incrementally, so the cost of a step
+// depends only on the lattice dimension and not on the length of the basis vectors.
+template <typename T, typename A>
+matrix<T, A> gram_LLL(matrix<T, A>& G, const T& delta, const LLL_options& options)
+{
+    using std::abs;
+    using std::round;
+    typedef std::chrono::steady_clock clock;
+
+    if (G.rows() != G.columns()) throw std::domain_error("gram matrix must be square");
+    if (!options.checkpoint_path.empty())
+        throw std::invalid_argument("gram_LLL does not support checkpointing");
+
+    LLL_stats* stats = options.stats;
+    clock::time_point begin_time = clock::now();
+    size_t gcd_calls_before = gcd_calls(delta);
+
+    int n = G.rows();
+    matrix<T, A> H(n, n, 0), mu(n, n, 0);
+    std::vector<T> norms(n);
+    for (int i = 0; i < n; ++i)
+        H(i, i) = 1;
+
+    // b_k <- b_k - round(mu_kl) * b_l
+    auto reduce = [&](int k, int l) {
+        if (2 * abs(mu(k, l)) <= 1) return;
+        T q = T(round(mu(k, l)));
+
+        for (int j = 0; j < n; ++j)
+            H(k, j) -= q * H(l, j);
+
+        G(k, k) += q * (q * G(l, l) - 2 * G(k, l));
+        for (int j = 0; j < n; ++j)
+        {
+            if (j == k) continue;
+            G(k, j) -= q * G(l, j);
+            G(j, k) = G(k, j);
+        }
+
+        mu(k, l) -= q;
+        for (int i = 0; i < l; ++i)
+            mu(k, i) -= q * mu(l, i);
+
+        if (stats) ++stats->size_reductions;
+    };
+
+    // exchanges b_k and b_(k-1)
+    auto swap = [&](int k, int kmax) {
+        using std::swap;
+        for (int j = 0; j < n; ++j)
+        {
+            swap(H(k, j), H(k - 1, j));
+            swap(G(k, j), G(k - 1, j));
+        }
+        for (int j = 0; j < n; ++j)
+            swap(G(j, k), G(j, k - 1));
+        for (int j = 0; j < k - 1; ++j)
+            swap(mu(k, j), mu(k - 1, j));
+
+        T m = mu(k, k - 1);
+        T B = norms[k] + sqaure(m) * norms[k - 1];
+        mu(k, k - 1) = m * norms[k - 1] / B;
+        norms[k] = norms[k - 1] * norms[k] / B;
+        norms[k - 1] = B;
+        for (int i = k + 1; i <= kmax; ++i)
+        {
+            T t = mu(i, k);
+            mu(i, k) = mu(i, k - 1) - m * t;
+            mu(i, k - 1) = t + mu(k, k - 1) * mu(i, k);
+        }
+
+        if (stats) ++stats->swaps;
+    };
+
+    norms[0] = G(0, 0);
+    if (norms[0] == 0) throw std::domain_error("basis vectors must be linearly independent");
+
+    for (int k = 1, kmax = 0; k < n;)
+    {
+        if (options.cancel) options.cancel->check();
+        if (k > kmax)
+        {
+            kmax = k;
+            for (int j = 0; j < k; ++j)
+            {
+                mu(k, j) = G(k, j);
+                for (int i = 0; i < j; ++i)
+                    mu(k, j) -= mu(j, i) * mu(k, i) * norms[i];
+                mu(k, j) /= norms[j];
+            }
+            norms[k] = G(k, k);
+            for (int j = 0; j < k; ++j)
+                norms[k] -= sqaure(mu(k, j)) * norms[j];
+            if (norms[k] == 0) throw std::domain_error("basis vectors must be linearly independent");
+        }
+
+        if (stats) ++stats->iterations;
+        if (stats && options.progress_interval != 0 && stats->iterations % options.progress_interval == 0)
+        {
+            stats->gcd_calls += gcd_calls(delta) - gcd_calls_before;
+            gcd_calls_before = gcd_calls(delta);
+            if (options.progress) options.progress(*stats, k);
+        }
+
+        reduce(k, k - 1);
+        if (norms[k] < (delta - sqaure(mu(k, k - 1))) * norms[k - 1])
+        {
+            swap(k, kmax);
+            k = std::max(k - 1, 1);
+        }
+        else
+        {
+            for (int l = k - 2; l >= 0; --l)
+                reduce(k, l);
+            ++k;
+        }
+    }
+
+    if (stats)
+    {
+        stats->gcd_calls += gcd_calls(delta) - gcd_calls_before;
+        stats->total_time += clock::now() - begin_time;
+    }
+    return H;
+}
+
+template <typename T, typename A>
+void LLL_via_gram(matrix<T, A>& m, const T& delta, const LLL_options& options)
+{
+    matrix<T, A> G = m * m.transpose();
+    m = gram_LLL(G, delta, options) * m;
+}
+
+template <typename T, typename A>
+bool is_LLL_reduced(const matrix<T, A>& m, const T& delta)
+{
+    using std::abs;
+
+    matrix<T, A> ortho = m, mu(m.rows(), m.rows());
+    std::vector<T> norms;
+    gram_schmidt(ortho, mu, norms);
+
+    for (int i = 1; i < m.rows(); ++i)
+    {
+        for (int j = 0; j < i; ++j)
+            if (2 * abs(mu(i, j)) > 1) return false;
+        if (norms[i] < (delta - sqaure(mu(i, i - 1))) * norms[i - 1]) return false;
+    }
+    return true;
+}
+
+template <typename T, typename A>
+T dot(const matrix<T, A>& a, const matrix<T, A>& b)
 {
     if (a.columns() != b.columns() || a.rows() != b.rows())
         throw std::invalid_argument("matrixes must have same shapes");
@@ -251,16 +930,16 @@ T dot(const matrix<T>& a, const matrix<T>& b)
     return res;
 }
 
-template <typename T>
-matrix<T>::matrix(size_t rows, size_t columns, const T& a)
-: m_rows(rows), m_columns(columns), arr(rows * columns, a)
+template <typename T, typename A>
+matrix<T, A>::matrix(size_t rows, size_t columns, const T& a)
+: m_rows(rows), m_columns(columns), arr(rows, columns, a)
 {
     if (rows == 0 || columns == 0) throw std::invalid_argument("can't create empty matrices");
 }
 
-template <typename T>
+template <typename T, typename A>
 template <typename T2>
-matrix<T>::matrix(const std::initializer_list<std::initializer_list<T2>>& _arr)
+matrix<T, A>::matrix(const std::initializer_list<std::initializer_list<T2>>& _arr)
 {
     if (_arr.size() == 0) throw std::invalid_argument("can't create empty matrices");
 
@@ -272,17 +951,21 @@ matrix<T>::matrix(const std::initializer_list<std::initializer_list<T2>>& _arr)
 
     if (columns() == 0) throw std::invalid_argument("can't create empty matrices");
 
-    arr = std::vector<T>(rows() * columns());
+    arr = typename matrix_storage<T, A>::type(rows(), columns(), T());
 
     int i = 0;
     for (const auto& v : _arr)
+    {
+        int j = 0;
         for (const T2& x : v)
-            arr[i++] = T(x);
+            arr(i, j++) = T(x);
+        ++i;
+    }
 }
 
-template <typename T>
+template <typename T, typename A>
 template <typename T2>
-matrix<T>::matrix(const std::vector<std::vector<T2>>& _arr)
+matrix<T, A>::matrix(const std::vector<std::vector<T2>>& _arr)
 {
     if (_arr.size() == 0) throw std::invalid_argument("can't create empty matrices");
 
@@ -294,40 +977,51 @@ matrix<T>::matrix(const std::vector<std::vector<T2>>& _arr)
 
     if (columns() == 0) throw std::invalid_argument("can't create empty matrices");
 
-    arr = std::vector<T>(rows() * columns());
+    arr = typename matrix_storage<T, A>::type(rows(), columns(), T());
 
     int i = 0;
     for (const auto& v : _arr)
+    {
+        int j = 0;
         for (const T2& x : v)
-            arr[i++] = T(x);
+            arr(i, j++) = T(x);
+        ++i;
+    }
 }
 
-template <typename T>
-size_t matrix<T>::rows() const
+template <typename T, typename A>
+template <typename A2>
+matrix<T, A>::matrix(const matrix<T, A2>& other)
+: m_rows(other.m_rows), m_columns(other.m_columns), arr(other.arr, other.m_rows, other.m_columns)
+{
+}
+
+template <typename T, typename A>
+size_t matrix<T, A>::rows() const
 {
     return m_rows;
 }
 
-template <typename T>
-size_t matrix<T>::columns() const
+template <typename T, typename A>
+size_t matrix<T, A>::columns() const
 {
     return m_columns;
 }
 
-template <typename T>
-inline const T& matrix<T>::operator()(size_t i, size_t j) const
+template <typename T, typename A>
+inline const T& matrix<T, A>::operator()(size_t i, size_t j) const
 {
-    return arr[i * columns() + j];
+    return arr(i, j);
 }
 
-template <typename T>
-inline T& matrix<T>::operator()(size_t i, size_t j)
+template <typename T, typename A>
+inline T& matrix<T, A>::operator()(size_t i, size_t j)
 {
-    return arr[i * columns() + j];
+    return arr(i, j);
 }
 
-template <typename T>
-bool matrix<T>::operator==(const matrix& other) const
+template <typename T, typename A>
+bool matrix<T, A>::operator==(const matrix& other) const
 {
     if (other.columns() != columns() || other.rows() != rows()) return false;
 
@@ -337,84 +1031,207 @@ bool matrix<T>::operator==(const matrix& other) const
     return true;
 }
 
-template <typename T>
-bool matrix<T>::operator!=(const matrix& other) const
+template <typename T, typename A>
+bool matrix<T, A>::operator!=(const matrix& other) const
 {
     return !(self == other);
 }
 
-template <typename T>
-matrix<T> matrix<T>::transpose() const
+// the side of the tiles of the cache oblivious transposes, small enough that the rows of a tile fit
+// in the ways of a cache set when the rows of the matrix are a power of 2 apart (larger tiles were
+// several times slower for 1024 x 1024 doubles)
+const size_t transpose_tile = 8;
+
+// sets res(j, i) = m(i, j) for the block [i_begin, i_end) x [j_begin, j_end) of m
+// the longer side of the block is halved until the block fits in a tile, so the rows read and the
+// rows written by a tile are in cache whatever the cache sizes are (cache oblivious)
+template <typename T, typename A>
+void transpose_block(const matrix<T, A>& m,
+                     matrix<T, A>& res,
+                     size_t i_begin,
+                     size_t i_end,
+                     size_t j_begin,
+                     size_t j_end)
 {
-    using namespace std;
-    matrix<T> res(columns(), rows(), 0);
+    if (i_end - i_begin <= transpose_tile && j_end - j_begin <= transpose_tile)
+    {
+        for (size_t i = i_begin; i < i_end; ++i)
+            for (size_t j = j_begin; j < j_end; ++j)
+                res(j, i) = m(i, j);
+    }
+    else if (i_end - i_begin >= j_end - j_begin)
+    {
+        size_t mid = i_begin + (i_end - i_begin) / 2;
+        transpose_block(m, res, i_begin, mid, j_begin, j_end);
+        transpose_block(m, res, mid, i_end, j_begin, j_end);
+    }
+    else
+    {
+        size_t mid = j_begin + (j_end - j_begin) / 2;
+        transpose_block(m, res, i_begin, i_end, j_begin, mid);
+        transpose_block(m, res, i_begin, i_end, mid, j_end);
+    }
+}
 
-    for (int i = 0; i < rows(); ++i)
-        for (int j = 0; j < columns(); ++j)
-            res(j, i) = self(i, j);
+// swaps m(i, j) and m(j, i) for the block [i_begin, i_end) x [j_begin, j_end) of m, which lies
+// above the diagonal, with the recursion of transpose_block
+template <typename T, typename A>
+void swap_transposed_block(matrix<T, A>& m, size_t i_begin, size_t i_end, size_t j_begin, size_t j_end)
+{
+    using std::swap;
+    if (i_end - i_begin <= transpose_tile && j_end - j_begin <= transpose_tile)
+    {
+        for (size_t i = i_begin; i < i_end; ++i)
+            for (size_t j = j_begin; j < j_end; ++j)
+                swap(m(i, j), m(j, i));
+    }
+    else if (i_end - i_begin >= j_end - j_begin)
+    {
+        size_t mid = i_begin + (i_end - i_begin) / 2;
+        swap_transposed_block(m, i_begin, mid, j_begin, j_end);
+        swap_transposed_block(m, mid, i_end, j_begin, j_end);
+    }
+    else
+    {
+        size_t mid = j_begin + (j_end - j_begin) / 2;
+        swap_transposed_block(m, i_begin, i_end, j_begin, mid);
+        swap_transposed_block(m, i_begin, i_end, mid, j_end);
+    }
+}
+
+// transposes the diagonal block [begin, end) x [begin, end) of m in place
+template <typename T, typename A>
+void transpose_diagonal_block(matrix<T, A>& m, size_t begin, size_t end)
+{
+    using std::swap;
+    if (end - begin <= transpose_tile)
+    {
+        for (size_t i = begin; i < end; ++i)
+            for (size_t j = i + 1; j < end; ++j)
+                swap(m(i, j), m(j, i));
+        return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    transpose_diagonal_block(m, begin, mid);
+    transpose_diagonal_block(m, mid, end);
+    swap_transposed_block(m, begin, mid, mid, end);
+}
 
+template <typename T, typename A>
+matrix<T, A>::matrix(size_t rows, size_t columns, typename matrix_storage<T, A>::type&& arr)
+: m_rows(rows), m_columns(columns), arr(std::move(arr))
+{
+}
+
+// entries which aren't trivially copyable are constructed in the order of the storage of the
+// result, from the transposed view of the storage of the matrix, so none of them is default
+// constructed and then assigned, a copy (or a move) dominates the cost of reading them out of order
+// trivially copyable entries are left uninitialized and then written tile by tile
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::transpose() const&
+{
+    typedef typename matrix_storage<T, A>::type storage;
+    if (!std::is_trivially_copyable<T>::value)
+        return matrix(columns(), rows(),
+                      storage(transposed_storage<storage, false>(arr), columns(), rows()));
+
+    matrix<T, A> res(columns(), rows(), storage(columns(), rows()));
+    transpose_block(self, res, 0, rows(), 0, columns());
     return res;
 }
 
-template <typename T>
+template <typename T, typename A>
+matrix<T, A> matrix<T, A>::transpose() &&
+{
+    typedef typename matrix_storage<T, A>::type storage;
+    if (std::is_trivially_copyable<T>::value) return static_cast<const matrix&>(self).transpose();
+    return matrix(columns(), rows(), storage(transposed_storage<storage, true>(arr), columns(), rows()));
+}
+
+template <typename T, typename A>
+void matrix<T, A>::transpose_in_place()
+{
+    if (rows() != columns()) throw std::domain_error("can't transpose a non-square matrix in place");
+    transpose_diagonal_block(self, 0, rows());
+}
+
+template <typename T, typename A>
 template <typename F>
-void matrix<T>::map(const F& f)
+void matrix<T, A>::map(const F& f)
 {
     for (int i = 0; i < rows(); ++i)
         for (int j = 0; j < rows(); ++j)
             self(i, j) = f(self(i, j));
 }
 
-template <typename T>
-void gaussian_elimination(matrix<T>& m)
+// applies the pivots [begin, end) to row t, in order, zero pivots are skipped
+// the pivot rows are only read, through pivots, so rows of several threads can be updated at once
+template <typename T, typename A>
+void eliminate_row(matrix<T, A>& m, size_t t, size_t begin, size_t end)
 {
-    using namespace std;
-    int t = 0;
-    T r;
+    const matrix<T, A>& pivots = m;
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (pivots(i, i) == 0 || pivots(t, i) == 0) continue;
+        T r = pivots(t, i) / pivots(i, i);
+        for (size_t j = i; j < m.columns(); ++j)
+            m(t, j) -= r * pivots(i, j);
+    }
+}
+
+// right looking and blocked: the pivot rows of a block are eliminated one after the other, and
+// then all the rows below the block are updated by the whole block at once, in parallel
+// every row is still updated by the pivots one at a time and in order, so the result is exactly the
+// one of eliminating by a single pivot at a time
+// a block of word sized entries (arithmetic types, static_modint) is long enough for the row to stay
+// in cache while the block is applied, big number entries are expensive enough that they are
+// updated after every pivot
+template <typename T, typename A>
+void gaussian_elimination(matrix<T, A>& m)
+{
+    using std::swap;
+    const size_t block_size = std::is_trivially_copyable<T>::value ? 32 : 1;
+    size_t rows = m.rows(), pivots = std::min(m.rows(), m.columns());
 
-    for (int i = 0; i < m.rows() && i < m.columns(); ++i)
+    for (size_t i = 0; i < pivots;)
     {
-        if (m(i, i) == 0)
+        // the rows [i, end) are the final pivot rows of the block
+        size_t end = i, updated_end = i;
+        for (; end < pivots && end < i + block_size; ++end)
         {
-            for (t = i + 1; t < m.rows() && m(t, i) == 0; ++t)
+            eliminate_row(m, end, i, end);
+            updated_end = end + 1;
+            if (m(end, end) != 0) continue;
+            // the rows below are updated by the block before looking for a pivot among them
+            if (end > i) break;
+
+            size_t t = end + 1;
+            for (; t < rows && m(t, end) == 0; ++t)
                 ;
-            if (t >= m.rows())
+            // a zero column is left as is, with a zero pivot
+            if (t == rows) continue;
+            for (size_t j = 0; j < m.columns(); ++j)
             {
-                --i;
-                continue;
-            }
-            if (t < m.rows())
-            {
-                for (int j = 0; j < m.columns(); ++j)
-                {
-                    swap(m(i, j), m(t, j));
-                    m(i, j) *= -1;
-                }
-            }
-            else
-            {
-                continue;
+                swap(m(end, j), m(t, j));
+                m(end, j) *= -1;
             }
         }
 
-        for (t = i + 1; t < m.rows(); ++t)
-        {
-            r = m(t, i) / m(i, i);
-            for (int j = i; j < m.columns(); ++j)
-            {
-                m(t, j) -= r * m(i, j);
-            }
-        }
+        parallel_for(updated_end, rows, (end - i) * (m.columns() - i), [&m, i, end](size_t t) {
+            eliminate_row(m, t, i, end);
+        });
+        i = end;
     }
 }
 
-template <typename T>
-T matrix<T>::det() const
+template <typename T, typename A>
+T matrix<T, A>::det() const
 {
     if (rows() != columns())
         throw std::domain_error("can't take determinanent of non-square matrix");
 
-    matrix M = self;
+    scoped_arena scope;
+    arena_matrix<T> M(self);
     gaussian_elimination(M);
     T res = 1;
     for (int i = 0; i < rows(); ++i)
@@ -422,8 +1239,8 @@ T matrix<T>::det() const
     return res;
 }
 
-template <typename T>
-T matrix<T>::trace() const
+template <typename T, typename A>
+T matrix<T, A>::trace() const
 {
     if (rows() != columns()) throw std::domain_error("can't take trace of non-square matrix");
 
@@ -433,8 +1250,34 @@ T matrix<T>::trace() const
     return res;
 }
 
-template <typename T>
-std::ostream& operator<<(std::ostream& out, const matrix<T>& m)
+template <typename T, typename A>
+void write_binary(std::ostream& os, const matrix<T, A>& m)
+{
+    write_binary(os, uint64_t(m.rows()));
+    write_binary(os, uint64_t(m.columns()));
+    for (int i = 0; i < m.rows(); ++i)
+        for (int j = 0; j < m.columns(); ++j)
+            write_binary(os, m(i, j));
+}
+
+template <typename T, typename A>
+void read_binary(std::istream& is, matrix<T, A>& m)
+{
+    uint64_t rows = 0, columns = 0;
+    read_binary(is, rows);
+    read_binary(is, columns);
+    if (!is) return;
+    if (rows == 0 || columns == 0) throw std::runtime_error("invalid matrix shape");
+
+    matrix<T, A> res(rows, columns);
+    for (int i = 0; i < rows; ++i)
+        for (int j = 0; j < columns; ++j)
+            read_binary(is, res(i, j));
+    m = res;
+}
+
+template <typename T, typename A>
+std::ostream& operator<<(std::ostream& out, const matrix<T, A>& m)
 {
     using AlgebraTAU::to_string;
     using std::to_string;
@@ -0,0 +1,219 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+// named counters and histograms which are cheap to update from many threads
+// every thread updates its own shard with relaxed atomic operations, so updates never block and
+// rarely contend, reading a value sums it over all the shards
+// a histogram has a bucket per power of 2, bucket 0 counts the zeros and bucket i > 0 counts the
+// values in [2^(i - 1), 2^i)
+class metrics
+{
+    public:
+    static const size_t histogram_buckets = 65;
+
+    private:
+    struct shard
+    {
+        std::unique_ptr<std::atomic<uint64_t>[]> values;
+
+        shard(size_t size) : values(new std::atomic<uint64_t>[size])
+        {
+            for (size_t i = 0; i < size; ++i)
+                values[i].store(0, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<std::string> counter_names, histogram_names;
+    // unique among all the metrics objects ever created, identifies the object in the thread caches
+    uint64_t id;
+
+    mutable std::mutex shards_mutex;
+    std::vector<std::unique_ptr<shard>> shards;
+
+    size_t shard_size() const
+    {
+        return counter_names.size() + histogram_names.size() * histogram_buckets;
+    }
+
+    static uint64_t next_id()
+    {
+        static std::atomic<uint64_t> id(0);
+        return ++id;
+    }
+
+    // the shard of the calling thread, every thread remembers its shards so the lock is only taken
+    // the first time a thread updates an object
+    shard& local_shard()
+    {
+        static thread_local std::vector<std::pair<uint64_t, shard*>> cache;
+        for (const auto& p : cache)
+            if (p.first == id) return *p.second;
+
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        shards.emplace_back(new shard(shard_size()));
+        cache.emplace_back(id, shards.back().get());
+        return *shards.back();
+    }
+
+    uint64_t sum(size_t index) const
+    {
+        std::lock_guard<std::mutex> lock(shards_mutex);
+        uint64_t res = 0;
+        for (const auto& s : shards)
+            res += s->values[index].load(std::memory_order_relaxed);
+        return res;
+    }
+
+    static std::string json_string(const std::string& s)
+    {
+        std::string res = "\"";
+        for (char ch : s)
+        {
+            if (ch == '"' || ch == '\\') res += '\\';
+            res += ch;
+        }
+        return res + "\"";
+    }
+
+    public:
+    metrics(const std::vector<std::string>& counter_names, const std::vector<std::string>& histogram_names)
+    : counter_names(counter_names), histogram_names(histogram_names), id(next_id())
+    {
+    }
+
+    metrics(const metrics&) = delete;
+    metrics& operator=(const metrics&) = delete;
+
+    // returns the bucket of a value in a histogram
+    static size_t bucket(uint64_t value)
+    {
+        size_t res = 0;
+        for (; value != 0; value >>= 1)
+            ++res;
+        return res;
+    }
+
+    void add(size_t counter, uint64_t value = 1)
+    {
+        local_shard().values[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void record(size_t histogram, uint64_t value)
+    {
+        size_t index = counter_names.size() + histogram * histogram_buckets + bucket(value);
+        local_shard().values[index].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t counter(size_t counter) const
+    {
+        return sum(counter);
+    }
+
+    std::vector<uint64_t> histogram(size_t histogram) const
+    {
+        std::vector<uint64_t> res(histogram_buckets);
+        for (size_t i = 0; i < histogram_buckets; ++i)
+            res[i] = sum(counter_names.size() + histogram * histogram_buckets + i);
+        return res;
+    }
+
+    // writes {"counters": {name: value, ...}, "histograms": {name: [bucket, ...], ...}}
+    // trailing empty buckets are omitted
+    void write_json(std::ostream& os) const
+    {
+        os << "{\n  \"counters\": {";
+        for (size_t i = 0; i < counter_names.size(); ++i)
+            os << (i == 0 ? "\n    " : ",\n    ") << json_string(counter_names[i]) << ": " << counter(i);
+        os << "\n  },\n  \"histograms\": {";
+        for (size_t i = 0; i < histogram_names.size(); ++i)
+        {
+            std::vector<uint64_t> h = histogram(i);
+            while (h.size() > 1 && h.back() == 0)
+                h.pop_back();
+            os << (i == 0 ? "\n    " : ",\n    ") << json_string(histogram_names[i]) << ": [";
+            for (size_t j = 0; j < h.size(); ++j)
+                os << (j == 0 ? "" : ", ") << h[j];
+            os << "]";
+        }
+        os << "\n  }\n}\n";
+    }
+
+    // writes a "name,bucket,value" line per counter (with an empty bucket) and per non empty
+    // histogram bucket
+    void write_csv(std::ostream& os) const
+    {
+        os << "name,bucket,value\n";
+        for (size_t i = 0; i < counter_names.size(); ++i)
+            os << counter_names[i] << ",," << counter(i) << "\n";
+        for (size_t i = 0; i < histogram_names.size(); ++i)
+        {
+            std::vector<uint64_t> h = histogram(i);
+            for (size_t j = 0; j < h.size(); ++j)
+                if (h[j] != 0) os << histogram_names[i] << "," << j << "," << h[j] << "\n";
+        }
+    }
+
+    // writes the metrics to path, as csv if path ends with ".csv" and as json otherwise
+    // the file is written aside and renamed over path, so a reader never sees a partial dump
+    // throws std::runtime_error if the file can't be written
+    void write(const std::string& path) const
+    {
+        std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream os(tmp_path);
+            if (!os) throw std::runtime_error("can't open " + tmp_path);
+            if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0)
+                write_csv(os);
+            else
+                write_json(os);
+            if (!os) throw std::runtime_error("can't write " + tmp_path);
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("can't rename " + tmp_path + " to " + path);
+    }
+};
+
+// adds the time from its construction to its destruction to a counter, in microseconds
+class scoped_timer
+{
+    metrics& m;
+    size_t counter;
+    std::chrono::steady_clock::time_point begin;
+
+    public:
+    scoped_timer(metrics& m, size_t counter)
+    : m(m), counter(counter), begin(std::chrono::steady_clock::now())
+    {
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+    ~scoped_timer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        m.add(counter, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+};
+
+} // namespace AlgebraTAU
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef MODINT_H
+#define MODINT_H
+
+#include <cryptopp/integer.h>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+// an element of Z/nZ for a modulus n chosen at runtime, e.g an RSA modulus
+// the elements derived from an element share its modulus, an element constructed from a plain
+// integer (like the literals 0 and 1 the algorithms of matrix use) has no modulus until it is
+// combined with an element that has one, and then it is reduced by that modulus
+// the modulus is kept as an Integer rather than a CryptoPP::ModularArithmetic, since the latter
+// returns its results in internal buffers and the rows of a matrix are updated on several threads
+// division needs an invertible divisor, so gaussian_elimination and det need a prime modulus (any
+// other modulus works as long as the pivots are invertible)
+class modint
+{
+    CryptoPP::Integer v;
+    std::shared_ptr<const CryptoPP::Integer> n;
+
+    // reduces v into [0, n), v is usually the sum or difference of two reduced elements
+    void reduce()
+    {
+        if (!n) return;
+        if (v >= *n)
+            v -= *n;
+        else if (v.IsNegative())
+            v += *n;
+        if (v.IsNegative() || v >= *n) v %= *n;
+    }
+
+    // gives an element without a modulus the modulus of o
+    // throws std::invalid_argument if both have a modulus and they are different
+    void bind(const modint& o)
+    {
+        if (!o.n || n == o.n) return;
+        if (!n)
+        {
+            n = o.n;
+            reduce();
+        }
+        else if (*n != *o.n)
+        {
+            throw std::invalid_argument("elements of different rings");
+        }
+    }
+
+    // checks whether x is congruent to the reduced value r modulo m
+    static bool congruent(const CryptoPP::Integer& r, const modint& x, const CryptoPP::Integer& m)
+    {
+        if (x.n || (x.v.NotNegative() && x.v < m)) return r == x.v;
+        return r == x.v % m;
+    }
+
+    public:
+    // an integer without a modulus
+    modint(const int64_t& a = 0) : v(a)
+    {
+    }
+
+    // a modulo m
+    // throws std::domain_error if m < 1
+    modint(const CryptoPP::Integer& a, const CryptoPP::Integer& m)
+    : v(a), n(std::make_shared<const CryptoPP::Integer>(m))
+    {
+        if (m < CryptoPP::Integer::One()) throw std::domain_error("modulus must be positive");
+        reduce();
+    }
+
+    // a modulo the modulus of other, the modulus is shared rather than copied
+    modint(const CryptoPP::Integer& a, const modint& other) : v(a), n(other.n)
+    {
+        reduce();
+    }
+
+    // the representative in [0, modulus()) or the integer itself if there is no modulus
+    const CryptoPP::Integer& value() const
+    {
+        return v;
+    }
+
+    // returns null if the element has no modulus
+    const CryptoPP::Integer* modulus() const
+    {
+        return n.get();
+    }
+
+    modint& operator+=(const modint& o)
+    {
+        bind(o);
+        v += o.v;
+        reduce();
+        return *this;
+    }
+
+    modint& operator-=(const modint& o)
+    {
+        bind(o);
+        v -= o.v;
+        reduce();
+        return *this;
+    }
+
+    modint& operator*=(const modint& o)
+    {
+        bind(o);
+        v *= o.v;
+        if (n) v %= *n;
+        return *this;
+    }
+
+    // throws std::domain_error if neither element has a modulus or o isn't invertible
+    modint& operator/=(const modint& o)
+    {
+        return *this *= o.inverse(n);
+    }
+
+    // throws std::domain_error if the element has no modulus or isn't invertible
+    modint inverse() const
+    {
+        return inverse(n);
+    }
+
+    modint operator-() const
+    {
+        modint res = *this;
+        res.v.Negate();
+        res.reduce();
+        return res;
+    }
+
+    bool IsZero() const
+    {
+        return v.IsZero();
+    }
+
+    friend bool operator==(const modint& a, const modint& b)
+    {
+        if (a.n && b.n && a.n != b.n && *a.n != *b.n) return false;
+        if (a.n) return congruent(a.v, b, *a.n);
+        if (b.n) return congruent(b.v, a, *b.n);
+        return a.v == b.v;
+    }
+
+    private:
+    // the inverse modulo the modulus of the element, or modulo m if it has none
+    modint inverse(const std::shared_ptr<const CryptoPP::Integer>& m) const
+    {
+        const std::shared_ptr<const CryptoPP::Integer>& ring = n ? n : m;
+        if (!ring) throw std::domain_error("can't invert an integer without a modulus");
+        if (n && m && n != m && *n != *m) throw std::invalid_argument("elements of different rings");
+        CryptoPP::Integer inv = v.InverseMod(*ring);
+        // the only unit of Z/1Z is 0
+        if (inv.IsZero() && *ring != CryptoPP::Integer::One())
+            throw std::domain_error("element is not invertible");
+        modint res;
+        res.v = inv;
+        res.n = ring;
+        return res;
+    }
+};
+
+inline modint operator+(const modint& a, const modint& b)
+{
+    modint res = a;
+    res += b;
+    return res;
+}
+
+inline modint operator-(const modint& a, const modint& b)
+{
+    modint res = a;
+    res -= b;
+    return res;
+}
+
+inline modint operator*(const modint& a, const modint& b)
+{
+    modint res = a;
+    res *= b;
+    return res;
+}
+
+inline modint operator/(const modint& a, const modint& b)
+{
+    modint res = a;
+    res /= b;
+    return res;
+}
+
+inline bool operator!=(const modint& a, const modint& b)
+{
+    return !(a == b);
+}
+
+inline std::string to_string(const modint& a)
+{
+    std::stringstream ss;
+    ss << a.value();
+    return ss.str();
+}
+
+// returns true if p is prime, by trial division
+constexpr bool is_prime(uint32_t p)
+{
+    if (p < 2) return false;
+    for (uint32_t d = 2; d <= p / d; ++d)
+        if (p % d == 0) return false;
+    return true;
+}
+
+// an element of Z/PZ for a prime P known at compile time, stored in a single machine word
+// the reductions are by a constant, which the compiler turns into multiplications, so there is no
+// need for a Montgomery form
+// P < 2^31 so a sum of two elements fits in a word
+template <uint32_t P>
+class static_modint
+{
+    static_assert(is_prime(P), "the modulus of static_modint must be prime");
+    static_assert(P < (uint32_t(1) << 31), "the modulus of static_modint must be smaller than 2^31");
+
+    uint32_t v;
+
+    static uint32_t reduce(int64_t a)
+    {
+        int64_t r = a % int64_t(P);
+        return uint32_t(r < 0 ? r + int64_t(P) : r);
+    }
+
+    public:
+    static_modint(const int64_t& a = 0) : v(reduce(a))
+    {
+    }
+
+    static constexpr uint32_t modulus()
+    {
+        return P;
+    }
+
+    // the representative in [0, P)
+    uint32_t value() const
+    {
+        return v;
+    }
+
+    static_modint& operator+=(const static_modint& o)
+    {
+        v += o.v;
+        if (v >= P) v -= P;
+        return *this;
+    }
+
+    static_modint& operator-=(const static_modint& o)
+    {
+        v = v >= o.v ? v - o.v : v + P - o.v;
+        return *this;
+    }
+
+    static_modint& operator*=(const static_modint& o)
+    {
+        v = uint32_t(uint64_t(v) * o.v % P);
+        return *this;
+    }
+
+    // throws std::domain_error if o is zero
+    static_modint& operator/=(const static_modint& o)
+    {
+        return *this *= o.inverse();
+    }
+
+    // returns the element to the power e
+    static_modint pow(uint64_t e) const
+    {
+        static_modint res = 1, base = *this;
+        for (; e; e >>= 1)
+        {
+            if (e & 1) res *= base;
+            base *= base;
+        }
+        return res;
+    }
+
+    // a^(P - 2) = a^-1 by fermat's little theorem
+    // throws std::domain_error if the element is zero
+    static_modint inverse() const
+    {
+        if (v == 0) throw std::domain_error("element is not invertible");
+        return pow(P - 2);
+    }
+
+    static_modint operator-() const
+    {
+        static_modint res;
+        res.v = v == 0 ? 0 : P - v;
+        return res;
+    }
+
+    bool IsZero() const
+    {
+        return v == 0;
+    }
+
+    friend static_modint operator+(static_modint a, const static_modint& b)
+    {
+        return a += b;
+    }
+
+    friend static_modint operator-(static_modint a, const static_modint& b)
+    {
+        return a -= b;
+    }
+
+    friend static_modint operator*(static_modint a, const static_modint& b)
+    {
+        return a *= b;
+    }
+
+    friend static_modint operator/(static_modint a, const static_modint& b)
+    {
+        return a /= b;
+    }
+
+    friend bool operator==(const static_modint& a, const static_modint& b)
+    {
+        return a.v == b.v;
+    }
+
+    friend bool operator!=(const static_modint& a, const static_modint& b)
+    {
+        return a.v != b.v;
+    }
+
+    friend std::string to_string(const static_modint& a)
+    {
+        return std::to_string(a.v);
+    }
+};
+
+// the primes commonly used for hashing and number theoretic transforms
+typedef static_modint<998244353> modint998244353;
+typedef static_modint<1000000007> modint1000000007;
+
+} // namespace AlgebraTAU
+
+inline std::ostream& operator<<(std::ostream& os, const AlgebraTAU::modint& a)
+{
+    return os << a.value();
+}
+
+template <uint32_t P>
+std::ostream& operator<<(std::ostream& os, const AlgebraTAU::static_modint<P>& a)
+{
+    return os << a.value();
+}
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef NORMAL_FORM_H
+#define NORMAL_FORM_H
+
+#include <cryptopp/integer.h>
+#include <stdexcept>
+#include <vector>
+
+#include "base.h"
+#include "matrix.h"
+
+namespace AlgebraTAU
+{
+
+// returns g = gcd(a, b) >= 0 and sets x, y such that x * a + y * b = g
+inline CryptoPP::Integer extended_gcd(const CryptoPP::Integer& a,
+                                      const CryptoPP::Integer& b,
+                                      CryptoPP::Integer& x,
+                                      CryptoPP::Integer& y)
+{
+    using CryptoPP::Integer;
+
+    Integer r0 = a.AbsoluteValue(), r1 = b.AbsoluteValue(), x0 = 1, x1 = 0, y0 = 0, y1 = 1, q, r;
+    while (!r1.IsZero())
+    {
+        Integer::Divide(r, q, r0, r1);
+        r0 = r1;
+        r1 = r;
+        Integer t = x0 - q * x1;
+        x0 = x1;
+        x1 = t;
+        t = y0 - q * y1;
+        y0 = y1;
+        y1 = t;
+    }
+    x = a.IsNegative() ? -x0 : x0;
+    y = b.IsNegative() ? -y0 : y0;
+    return r0;
+}
+
+// returns the n x n identity matrix
+template <typename T, typename A = std::allocator<T>>
+matrix<T, A> identity(size_t n)
+{
+    matrix<T, A> res(n, n, 0);
+    for (size_t i = 0; i < n; ++i)
+        res(i, i) = 1;
+    return res;
+}
+
+// replaces the rows i and k of m by x * m_i + y * m_k and z * m_i + w * m_k, from column begin on
+template <typename A>
+void combine_rows(matrix<CryptoPP::Integer, A>& m,
+                  size_t i,
+                  size_t k,
+                  const CryptoPP::Integer& x,
+                  const CryptoPP::Integer& y,
+                  const CryptoPP::Integer& z,
+                  const CryptoPP::Integer& w,
+                  size_t begin = 0)
+{
+    for (size_t j = begin; j < m.columns(); ++j)
+    {
+        CryptoPP::Integer a = m(i, j), b = m(k, j);
+        m(i, j) = x * a + y * b;
+        m(k, j) = z * a + w * b;
+    }
+}
+
+// replaces the columns i and k of m by x * m^i + y * m^k and z * m^i + w * m^k
+template <typename A>
+void combine_columns(matrix<CryptoPP::Integer, A>& m,
+                     size_t i,
+                     size_t k,
+                     const CryptoPP::Integer& x,
+                     const CryptoPP::Integer& y,
+                     const CryptoPP::Integer& z,
+                     const CryptoPP::Integer& w)
+{
+    for (size_t j = 0; j < m.rows(); ++j)
+    {
+        CryptoPP::Integer a = m(j, i), b = m(j, k);
+        m(j, i) = x * a + y * b;
+        m(j, k) = z * a + w * b;
+    }
+}
+
+// fraction free (Bareiss) gauss jordan elimination of m, in place
+// the columns of the pivots are stored in pivots, in order, and the pivot rows are the first
+// pivots.size() rows of m
+// returns d, +-the determinant of the minor of m on the pivot rows and columns, every pivot is d and
+// the rest of the pivot columns and the rows below the pivot rows are zero, so m / d is the reduced
+// row echelon form of m
+// every intermediate entry is a minor of m, so the entries never grow beyond the size of d
+// the rows are updated in parallel when m is large enough
+template <typename A>
+CryptoPP::Integer fraction_free_echelon(matrix<CryptoPP::Integer, A>& m, std::vector<size_t>& pivots)
+{
+    using CryptoPP::Integer;
+    using std::swap;
+
+    const matrix<Integer, A>& M = m;
+    size_t rows = m.rows(), columns = m.columns();
+    Integer previous = 1;
+    pivots.clear();
+    for (size_t c = 0; c < columns && pivots.size() < rows; ++c)
+    {
+        size_t r = pivots.size(), p = r;
+        while (p < rows && M(p, c).IsZero())
+            ++p;
+        if (p == rows) continue;
+        if (p != r)
+            for (size_t j = 0; j < columns; ++j)
+                swap(m(r, j), m(p, j));
+
+        // the pivot row is only read, through M, and the earlier pivots (previous) become M(r, c),
+        // as the rest of their rows is scaled
+        parallel_for(0, rows, columns, [&m, &M, &previous, r, c, columns](size_t i) {
+            if (i == r) return;
+            Integer factor = M(i, c);
+            for (size_t j = 0; j < columns; ++j)
+                if (j != c) m(i, j) = (M(r, c) * M(i, j) - factor * M(r, j)) / previous;
+            m(i, c) = 0;
+        });
+        previous = M(r, c);
+        pivots.push_back(c);
+    }
+    return previous;
+}
+
+// calculates inverse = d * m^-1 by fraction free elimination of [m | I], where d is +-det(m), and
+// returns d
+// returns 0 (and leaves inverse unspecified) if m is singular
+// throws std::domain_error if m is not square
+template <typename A>
+CryptoPP::Integer integer_inverse(const matrix<CryptoPP::Integer, A>& m, matrix<CryptoPP::Integer, A>& inverse)
+{
+    using CryptoPP::Integer;
+
+    size_t n = m.rows();
+    if (n != m.columns()) throw std::domain_error("can't invert a non-square matrix");
+
+    matrix<Integer, A> M(n, 2 * n, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+            M(i, j) = m(i, j);
+        M(i, n + i) = 1;
+    }
+    std::vector<size_t> pivots;
+    Integer d = fraction_free_echelon(M, pivots);
+    // [m | I] always has n pivots, m is singular iff one of them is in I
+    if (pivots[n - 1] != n - 1) return 0;
+
+    inverse = matrix<Integer, A>(n, n);
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            inverse(i, j) = M(i, n + j);
+    return d;
+}
+
+// brings the entries above the pivot m(r, c) > 0 into [0, m(r, c)), applying the same row
+// operations to U if it is not null
+template <typename A>
+void reduce_above_pivot(matrix<CryptoPP::Integer, A>& m, matrix<CryptoPP::Integer, A>* U, size_t r, size_t c)
+{
+    CryptoPP::Integer q, remainder;
+    for (size_t k = 0; k < r; ++k)
+    {
+        CryptoPP::Integer::Divide(remainder, q, m(k, c), m(r, c));
+        if (q.IsZero()) continue;
+        for (size_t j = c; j < m.columns(); ++j)
+            m(k, j) -= q * m(r, j);
+        if (U)
+            for (size_t j = 0; j < U->columns(); ++j)
+                (*U)(k, j) -= q * (*U)(r, j);
+    }
+}
+
+// hermite normal form of a square nonsingular m, with |det(m)| = det, computed modulo det
+// (Domich, Kannan and Trotter, see Henri Cohen's "A Course in Computational Algebraic Number
+// Theory", algorithm 2.4.8)
+// the lattice of m contains det * Z^n, so all the entries are kept reduced modulo a divisor of det,
+// which bounds their size no matter how many row operations are preformed
+template <typename A>
+void modular_hermite_normal_form(matrix<CryptoPP::Integer, A>& m, const CryptoPP::Integer& det)
+{
+    using CryptoPP::Integer;
+
+    size_t n = m.rows();
+    Integer R = det.AbsoluteValue(), x, y;
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j)
+            m(i, j) %= R;
+
+    for (size_t c = 0; c < n; ++c)
+    {
+        for (size_t i = c + 1; i < n; ++i)
+        {
+            if (m(i, c).IsZero()) continue;
+            Integer g = extended_gcd(m(c, c), m(i, c), x, y);
+            combine_rows(m, c, i, x, y, -(m(i, c) / g), m(c, c) / g, c);
+            for (size_t j = c; j < n; ++j)
+            {
+                m(c, j) %= R;
+                m(i, j) %= R;
+            }
+        }
+
+        // the pivot is the gcd of the column and R, the lattice of the remaining columns contains
+        // (R / d) * Z^(n - c - 1)
+        Integer d = extended_gcd(m(c, c), R, x, y);
+        for (size_t j = c + 1; j < n; ++j)
+            m(c, j) = x * m(c, j) % R;
+        m(c, c) = d;
+        R /= d;
+        for (size_t i = c + 1; i < n; ++i)
+            for (size_t j = c + 1; j < n; ++j)
+                m(i, j) %= R;
+    }
+
+    for (size_t c = 1; c < n; ++c)
+        reduce_above_pivot<A>(m, nullptr, c, c);
+}
+
+// hermite normal form of any m by extended gcd row operations, applied to U as well if it is not null
+template <typename A>
+void euclidean_hermite_normal_form(matrix<CryptoPP::Integer, A>& m, matrix<CryptoPP::Integer, A>* U)
+{
+    using CryptoPP::Integer;
+
+    Integer x, y;
+    size_t r = 0;
+    for (size_t c = 0; c < m.columns() && r < m.rows(); ++c)
+    {
+        for (size_t i = r + 1; i < m.rows(); ++i)
+        {
+            if (m(i, c).IsZero()) continue;
+            Integer g = extended_gcd(m(r, c), m(i, c), x, y);
+            Integer z = -(m(i, c) / g), w = m(r, c) / g;
+            combine_rows(m, r, i, x, y, z, w, c);
+            if (U) combine_rows(*U, r, i, x, y, z, w);
+        }
+        if (m(r, c).IsZero()) continue;
+        if (m(r, c).IsNegative())
+        {
+            for (size_t j = c; j < m.columns(); ++j)
+                m(r, j).Negate();
+            if (U)
+                for (size_t j = 0; j < U->columns(); ++j)
+                    (*U)(r, j).Negate();
+        }
+        reduce_above_pivot(m, U, r, c);
+        ++r;
+    }
+}
+
+// replaces m by its row-wise hermite normal form H and returns the unimodular U such that
+// H = U * m (the original m)
+// H spans the same lattice as the rows of m: its nonzero rows come first, the pivot (first nonzero
+// entry) of every row is positive and to the right of the pivot of the row above it, and the
+// entries above a pivot are in [0, pivot), so two matrices span the same lattice iff the nonzero
+// rows of their hermite normal forms are equal
+// a square nonsingular m is reduced modulo its determinant, which keeps the entries small, and U is
+// then recovered from the inverse of m, other shapes are reduced by extended gcd row operations
+template <typename A>
+matrix<CryptoPP::Integer, A> hermite_normal_form(matrix<CryptoPP::Integer, A>& m)
+{
+    using CryptoPP::Integer;
+
+    if (m.rows() == m.columns())
+    {
+        matrix<Integer, A> inverse(m.rows(), m.rows());
+        Integer d = integer_inverse(m, inverse);
+        if (!d.IsZero())
+        {
+            modular_hermite_normal_form(m, d);
+            matrix<Integer, A> U = m * inverse;
+            for (size_t i = 0; i < U.rows(); ++i)
+                for (size_t j = 0; j < U.columns(); ++j)
+                    U(i, j) /= d;
+            return U;
+        }
+    }
+
+    matrix<Integer, A> U = identity<Integer, A>(m.rows());
+    euclidean_hermite_normal_form(m, &U);
+    return U;
+}
+
+// checks if the rows of a and the rows of b span the same lattice
+template <typename A>
+bool same_lattice(const matrix<CryptoPP::Integer, A>& a, const matrix<CryptoPP::Integer, A>& b)
+{
+    if (a.columns() != b.columns()) return false;
+
+    matrix<CryptoPP::Integer, A> H[2] = { a, b };
+    size_t rank[2];
+    for (int t = 0; t < 2; ++t)
+    {
+        matrix<CryptoPP::Integer, A>& h = H[t];
+        if (h.rows() == h.columns())
+        {
+            matrix<CryptoPP::Integer, A> inverse(h.rows(), h.rows());
+            CryptoPP::Integer d = integer_inverse(h, inverse);
+            if (d.IsZero())
+                euclidean_hermite_normal_form<A>(h, nullptr);
+            else
+                modular_hermite_normal_form(h, d);
+        }
+        else
+        {
+            euclidean_hermite_normal_form<A>(h, nullptr);
+        }
+
+        rank[t] = h.rows();
+        while (rank[t] > 0)
+        {
+            bool zero = true;
+            for (size_t j = 0; j < h.columns() && zero; ++j)
+                zero = h(rank[t] - 1, j).IsZero();
+            if (!zero) break;
+            --rank[t];
+        }
+    }
+
+    if (rank[0] != rank[1]) return false;
+    for (size_t i = 0; i < rank[0]; ++i)
+        for (size_t j = 0; j < a.columns(); ++j)
+            if (H[0](i, j) != H[1](i, j)) return false;
+    return true;
+}
+
+// replaces m by its smith normal form S and sets the unimodular P and Q such that S = P * m * Q
+// S is diagonal (not necessarily square), its diagonal is non negative and every entry of the
+// diagonal divides the next one, the nonzero entries are the elementary divisors of m
+// row and column hermite normal forms are alternated until m is diagonal, then the divisibility
+// of the diagonal is fixed by replacing pairs of entries by their gcd and lcm
+template <typename A>
+void smith_normal_form(matrix<CryptoPP::Integer, A>& m, matrix<CryptoPP::Integer, A>& P, matrix<CryptoPP::Integer, A>& Q)
+{
+    using CryptoPP::Integer;
+
+    auto is_diagonal = [&m]() {
+        for (size_t i = 0; i < m.rows(); ++i)
+            for (size_t j = 0; j < m.columns(); ++j)
+                if (i != j && !m(i, j).IsZero()) return false;
+        return true;
+    };
+
+    P = identity<Integer, A>(m.rows());
+    Q = identity<Integer, A>(m.columns());
+    while (true)
+    {
+        P = hermite_normal_form(m) * P;
+        if (is_diagonal()) break;
+        matrix<Integer, A> t = m.transpose();
+        Q *= hermite_normal_form(t).transpose();
+        m = t.transpose();
+        if (is_diagonal()) break;
+    }
+
+    Integer x, y;
+    size_t n = std::min(m.rows(), m.columns());
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = i + 1; j < n; ++j)
+        {
+            Integer a = m(i, i), b = m(j, j);
+            if (a.IsZero() ? b.IsZero() : (b % a).IsZero()) continue;
+
+            // (a, 0; 0, b) -> (a, b; 0, b) -> (g, 0; y * b, lcm) -> (g, 0; 0, lcm)
+            Integer g = extended_gcd(a, b, x, y);
+            combine_rows(m, i, j, Integer::One(), Integer::One(), Integer::Zero(), Integer::One());
+            combine_rows(P, i, j, Integer::One(), Integer::One(), Integer::Zero(), Integer::One());
+            combine_columns(m, i, j, x, y, -(b / g), a / g);
+            combine_columns(Q, i, j, x, y, -(b / g), a / g);
+            Integer q = m(j, i) / g;
+            combine_rows(m, i, j, Integer::One(), Integer::Zero(), -q, Integer::One());
+            combine_rows(P, i, j, Integer::One(), Integer::Zero(), -q, Integer::One());
+        }
+}
+
+} // namespace AlgebraTAU
+
+#endif
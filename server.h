@@ -0,0 +1,235 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <cryptopp/files.h>
+#include <cryptopp/integer.h>
+#include <cryptopp/modarith.h>
+#include <cryptopp/osrng.h>
+#include <cryptopp/rsa.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "thread_pool.h"
+
+// deterministic random number generator of the seeded mode
+// the same seed and stream always give the same bytes, different streams of a seed are
+// independent, so every consumer can get its own sequence without depending on the others
+class SeededRng : public CryptoPP::RandomNumberGenerator
+{
+    std::mt19937_64 engine;
+
+    public:
+    SeededRng(uint64_t seed, uint64_t stream = 0)
+    {
+        std::seed_seq seq{ uint32_t(seed), uint32_t(seed >> 32), uint32_t(stream), uint32_t(stream >> 32) };
+        engine.seed(seq);
+    }
+
+    void GenerateBlock(CryptoPP::byte* output, size_t size) override
+    {
+        for (size_t i = 0; i < size; i += 8)
+        {
+            uint64_t r = engine();
+            for (size_t j = i; j < std::min(i + 8, size); ++j, r >>= 8)
+                output[j] = r & 0xff;
+        }
+    }
+};
+
+class Server
+{
+    private:
+    CryptoPP::RSA::PrivateKey privateKey;
+
+    public:
+    int keysize;
+    CryptoPP::RSA::PublicKey publicKey;
+
+    Server(int keysize) : keysize(keysize)
+    {
+        CryptoPP::AutoSeededRandomPool prng;
+        privateKey.GenerateRandomWithKeySize(prng, keysize);
+        publicKey = CryptoPP::RSA::PublicKey(privateKey);
+    }
+
+    // generates the key with rng, a SeededRng gives the same key every time
+    Server(int keysize, CryptoPP::RandomNumberGenerator& rng) : keysize(keysize)
+    {
+        privateKey.GenerateRandomWithKeySize(rng, keysize);
+        publicKey = CryptoPP::RSA::PublicKey(privateKey);
+    }
+
+    // loads a key saved by save()
+    explicit Server(const std::string& key_path)
+    {
+        CryptoPP::FileSource file(key_path.c_str(), true);
+        privateKey.Load(file);
+        publicKey = CryptoPP::RSA::PublicKey(privateKey);
+        keysize = publicKey.GetModulus().BitCount();
+    }
+
+    void save(const std::string& key_path) const
+    {
+        CryptoPP::FileSink file(key_path.c_str());
+        privateKey.Save(file);
+        file.MessageEnd();
+    }
+
+    Server(const Server& srv)
+    : privateKey(srv.privateKey), keysize(srv.keysize), publicKey(srv.publicKey)
+    {
+    }
+
+    Server& operator=(const Server& srv)
+    {
+        publicKey = srv.publicKey;
+        privateKey = srv.privateKey;
+        keysize = srv.keysize;
+        return *this;
+    }
+
+    private:
+    // checks the padding of a decrypted message
+    static bool is_pkcs_padded(const CryptoPP::Integer& m, int keysize)
+    {
+        int sz = m.ByteCount();
+        if (sz * 8 != keysize - 8) return false;
+        if (m.GetByte(sz - 1) != 2) return false;
+        for (int i = sz - 2; i > sz - 10; --i)
+            if (m.GetByte(i) == 0) return false;
+        for (int i = sz - 10; i >= 0; --i)
+            if (m.GetByte(i) == 0) return true;
+        return false;
+    }
+
+    public:
+    // fast oracle of the local simulation
+    // decrypts with the CRT and without blinding, the Montgomery contexts of n, p and q are built
+    // once and c is kept in the Montgomery form of n, so a pivot costs one exponentiation by e,
+    // one multiplication and two half size exponentiations
+    // the contexts keep internal buffers, so an oracle must not be shared between threads
+    class Oracle
+    {
+        const Server& srv;
+        const CryptoPP::Integer& e;
+        const CryptoPP::Integer& p;
+        const CryptoPP::Integer& q;
+        const CryptoPP::Integer& dp;
+        const CryptoPP::Integer& dq;
+        const CryptoPP::Integer& u;
+        CryptoPP::MontgomeryRepresentation mod_n, mod_p, mod_q;
+        CryptoPP::Integer c_in;
+
+        public:
+        Oracle(const Server& srv, const CryptoPP::Integer& c)
+        : srv(srv), e(srv.publicKey.GetPublicExponent()), p(srv.privateKey.GetPrime1()),
+          q(srv.privateKey.GetPrime2()), dp(srv.privateKey.GetModPrime1PrivateExponent()),
+          dq(srv.privateKey.GetModPrime2PrivateExponent()),
+          u(srv.privateKey.GetMultiplicativeInverseOfPrime2ModPrime1()), mod_n(srv.publicKey.GetModulus()),
+          mod_p(p), mod_q(q), c_in(mod_n.ConvertIn(c))
+        {
+        }
+
+        // same as Server::is_pkcs_conforming
+        bool is_pkcs_conforming(const CryptoPP::Integer& x) const
+        {
+            CryptoPP::Integer mp = mod_p.ConvertOut(mod_p.Exponentiate(mod_p.ConvertIn(x), dp));
+            CryptoPP::Integer mq = mod_q.ConvertOut(mod_q.Exponentiate(mod_q.ConvertIn(x), dq));
+            CryptoPP::Integer h = (mp - mq).Times(u).Modulo(p);
+            return is_pkcs_padded(h.Times(q).Plus(mq), srv.keysize);
+        }
+
+        // checks whether s^e * c is pkcs conforming
+        bool is_good_pivot(const CryptoPP::Integer& s) const
+        {
+            CryptoPP::Integer x = mod_n.Multiply(mod_n.Exponentiate(mod_n.ConvertIn(s), e), c_in);
+            return is_pkcs_conforming(mod_n.ConvertOut(x));
+        }
+
+        // checks the pivots in candidates in parallel on the pool and returns the index of the first
+        // good one, or -1 if there is none
+        // the candidates are claimed in order, and a thread stops claiming once it sees a good pivot
+        // before the next candidate, but the other threads may still check a few candidates after
+        // the good one until they see it
+        // every task works on its own copy of the oracle
+        // if queries isn't null, the number of pivots actually checked is added to it
+        // if sequential_queries isn't null, the number of pivots a sequential search would check is
+        // added to it, which doesn't depend on the timing of the threads
+        int first_good_pivot(const std::vector<CryptoPP::Integer>& candidates,
+                             AlgebraTAU::thread_pool& pool,
+                             int* queries = nullptr,
+                             int* sequential_queries = nullptr) const
+        {
+            int size = candidates.size();
+            std::atomic_int next(0), first(size), calls(0);
+
+            pool.parallel_for(0, std::min<size_t>(pool.size() + 1, size), [&](size_t) {
+                std::unique_ptr<Oracle> local;
+                for (int i; (i = next++) < first;)
+                {
+                    if (!local) local.reset(new Oracle(*this));
+                    ++calls;
+                    if (!local->is_good_pivot(candidates[i])) continue;
+                    for (int j = first; i < j && !first.compare_exchange_weak(j, i);)
+                        ;
+                }
+            });
+
+            if (queries != nullptr) *queries += calls;
+            if (sequential_queries != nullptr) *sequential_queries += first < size ? first + 1 : size;
+            return first < size ? int(first) : -1;
+        }
+    };
+
+    // decrypts c the way a real server would, with blinding
+    bool is_pkcs_conforming(const CryptoPP::Integer& c) const
+    {
+        static thread_local CryptoPP::AutoSeededRandomPool prng;
+        return is_pkcs_padded(privateKey.CalculateInverse(prng, c), keysize);
+    }
+
+    CryptoPP::Integer pkcs_encrypt(const std::string& s) const
+    {
+        static thread_local CryptoPP::AutoSeededRandomPool prng;
+        return pkcs_encrypt(s, prng);
+    }
+
+    // pads s with bytes from rng
+    CryptoPP::Integer pkcs_encrypt(const std::string& s, CryptoPP::RandomNumberGenerator& rng) const
+    {
+        int max_size = publicKey.GetModulus().ByteCount() - 11;
+        if (s.length() > max_size)
+            throw std::overflow_error("message too long, max size is " + std::to_string(max_size));
+
+        int pad = publicKey.GetModulus().ByteCount() - 3 - s.length();
+        CryptoPP::byte rnd;
+        CryptoPP::Integer res = CryptoPP::Integer::Power2(keysize) - 1;
+        int sz = res.ByteCount();
+        res.SetByte(sz - 2, 2);
+
+        for (int i = 0; i < pad; ++i)
+        {
+            do
+            {
+                rnd = rng.GenerateByte();
+            } while (rnd == 0);
+            res.SetByte(sz - 3 - i, rnd);
+        }
+        res.SetByte(sz - 3 - pad, 0);
+
+        for (int i = 0; i < s.length(); ++i)
+            res.SetByte((sz - 4 - pad) - i, s[i]);
+
+        res.SetByte(sz - 1, 0);
+        return publicKey.ApplyFunction(res);
+    }
+};
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+// given as the allocator of a matrix, selects copy on write storage whose rows are allocated by A
+// i.e matrix<T, copy_on_write<std::allocator<T>>>, see cow_storage
+template <typename A>
+struct copy_on_write
+{
+};
+
+// the allocator A, except that elements constructed without arguments are default initialized
+// rather than value initialized, so a buffer of trivial elements which is about to be overwritten
+// isn't filled with zeros first
+template <typename A>
+class default_init_allocator : public A
+{
+    typedef std::allocator_traits<A> traits;
+
+    public:
+    template <typename U>
+    struct rebind
+    {
+        typedef default_init_allocator<typename traits::template rebind_alloc<U>> other;
+    };
+
+    default_init_allocator() = default;
+
+    default_init_allocator(const A& a) : A(a)
+    {
+    }
+
+    template <typename B>
+    default_init_allocator(const default_init_allocator<B>& other) : A(static_cast<const B&>(other))
+    {
+    }
+
+    template <typename U>
+    void construct(U* p)
+    {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        traits::construct(static_cast<A&>(*this), p, std::forward<Args>(args)...);
+    }
+};
+
+template <typename A, typename B>
+bool operator==(const default_init_allocator<A>& a, const default_init_allocator<B>& b)
+{
+    return static_cast<const A&>(a) == static_cast<const B&>(b);
+}
+
+template <typename A, typename B>
+bool operator!=(const default_init_allocator<A>& a, const default_init_allocator<B>& b)
+{
+    return !(a == b);
+}
+
+// the row-wise storage of the entries of a rows x columns matrix, in a single buffer allocated by A
+template <typename T, typename A>
+class dense_storage
+{
+    size_t m_columns = 0;
+    std::vector<T, default_init_allocator<A>> arr;
+
+    public:
+    typedef T value_type;
+    typedef A allocator_type;
+
+    dense_storage() = default;
+
+    dense_storage(size_t rows, size_t columns, const T& a) : m_columns(columns), arr(rows * columns, a)
+    {
+    }
+
+    // default initializes the entries, so trivial entries are left uninitialized and must be
+    // assigned before they are read
+    dense_storage(size_t rows, size_t columns) : m_columns(columns), arr(rows * columns)
+    {
+    }
+
+    // copies the entries of another storage of the same shape
+    template <typename S>
+    dense_storage(const S& other, size_t rows, size_t columns) : m_columns(columns)
+    {
+        arr.reserve(rows * columns);
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t j = 0; j < columns; ++j)
+                arr.push_back(other(i, j));
+    }
+
+    const T& operator()(size_t i, size_t j) const
+    {
+        return arr[i * m_columns + j];
+    }
+
+    T& operator()(size_t i, size_t j)
+    {
+        return arr[i * m_columns + j];
+    }
+};
+
+// copy on write storage: every row is a reference counted buffer allocated by A, copies of the
+// storage share their rows and a shared row is duplicated the first time it is accessed for writing
+// so copying a matrix costs a reference per row, and only the rows which are modified are copied
+// reading through a non const matrix counts as writing, algorithms which only read a matrix should
+// take it by const reference
+// a reference returned by the non const access operator may point into a row which a later copy
+// of the matrix shares, so it must not be written through once the matrix was copied
+// copies which share rows may be modified on different threads
+template <typename T, typename A>
+class cow_storage
+{
+    typedef std::vector<T, default_init_allocator<A>> row_type;
+
+    std::vector<std::shared_ptr<row_type>> rows;
+
+    static std::shared_ptr<row_type> make_row(const row_type& r)
+    {
+        return std::allocate_shared<row_type>(A(), r, A());
+    }
+
+    public:
+    typedef T value_type;
+    typedef A allocator_type;
+
+    cow_storage() = default;
+
+    cow_storage(size_t rows, size_t columns, const T& a)
+    {
+        this->rows.reserve(rows);
+        for (size_t i = 0; i < rows; ++i)
+            this->rows.push_back(std::allocate_shared<row_type>(A(), columns, a, A()));
+    }
+
+    // default initializes the entries, see dense_storage
+    cow_storage(size_t rows, size_t columns)
+    {
+        this->rows.reserve(rows);
+        for (size_t i = 0; i < rows; ++i)
+            this->rows.push_back(std::allocate_shared<row_type>(A(), columns, A()));
+    }
+
+    // copies the entries of another storage of the same shape
+    template <typename S>
+    cow_storage(const S& other, size_t rows, size_t columns)
+    {
+        this->rows.reserve(rows);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            std::shared_ptr<row_type> r = std::allocate_shared<row_type>(A(), A());
+            r->reserve(columns);
+            for (size_t j = 0; j < columns; ++j)
+                r->push_back(other(i, j));
+            this->rows.push_back(std::move(r));
+        }
+    }
+
+    const T& operator()(size_t i, size_t j) const
+    {
+        return (*rows[i])[j];
+    }
+
+    T& operator()(size_t i, size_t j)
+    {
+        std::shared_ptr<row_type>& r = rows[i];
+        if (r.use_count() != 1)
+            r = make_row(*r);
+        else
+            // the other owners may have just finished copying the row on another thread
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return (*r)[j];
+    }
+};
+
+// the transpose of a storage S, a storage of the transposed shape is constructed from it without
+// default constructing its entries first
+// if Move, the entries are moved out of the storage (so accessing it counts as writing to it)
+template <typename S, bool Move>
+class transposed_storage
+{
+    typedef typename S::value_type T;
+    typedef typename std::conditional<Move, S&, const S&>::type reference;
+
+    reference s;
+
+    public:
+    explicit transposed_storage(reference s) : s(s)
+    {
+    }
+
+    typename std::conditional<Move, T&&, const T&>::type operator()(size_t i, size_t j) const
+    {
+        return static_cast<typename std::conditional<Move, T&&, const T&>::type>(s(j, i));
+    }
+};
+
+// the storage of the entries of a matrix<T, A>
+template <typename T, typename A>
+struct matrix_storage
+{
+    typedef dense_storage<T, A> type;
+};
+
+template <typename T, typename A>
+struct matrix_storage<T, copy_on_write<A>>
+{
+    typedef cow_storage<T, A> type;
+};
+
+// the allocator of the storage of a vector<O, T, A>, vectors are always stored in a single buffer
+template <typename A>
+struct storage_allocator
+{
+    typedef A type;
+};
+
+template <typename A>
+struct storage_allocator<copy_on_write<A>>
+{
+    typedef A type;
+};
+
+} // namespace AlgebraTAU
+
+#endif
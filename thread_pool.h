@@ -0,0 +1,361 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "base.h"
+
+namespace AlgebraTAU
+{
+
+typedef std::function<void()> pool_task;
+
+// lock-free work stealing deque of tasks (Chase and Lev, "Dynamic Circular Work-Stealing Deque",
+// with the memory orderings of Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+// Models")
+// only the owner thread may push and pop (from the bottom), any thread may steal (from the top)
+class work_stealing_deque
+{
+    // circular array of task pointers, its capacity is a power of 2
+    struct buffer
+    {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<pool_task*>[]> items;
+
+        buffer(int64_t capacity) : capacity(capacity), items(new std::atomic<pool_task*>[capacity])
+        {
+        }
+
+        pool_task* get(int64_t i) const
+        {
+            return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, pool_task* t)
+        {
+            items[i & (capacity - 1)].store(t, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<int64_t> top, bottom;
+    std::atomic<buffer*> array;
+    // buffers replaced by grow(), stealers may still read them so they are freed with the deque
+    std::vector<std::unique_ptr<buffer>> buffers;
+
+    buffer* grow(buffer* old, int64_t b, int64_t t)
+    {
+        buffers.emplace_back(new buffer(old->capacity * 2));
+        buffer* res = buffers.back().get();
+        for (int64_t i = t; i < b; ++i)
+            res->put(i, old->get(i));
+        array.store(res, std::memory_order_release);
+        return res;
+    }
+
+    public:
+    work_stealing_deque(int64_t capacity = 64) : top(0), bottom(0)
+    {
+        buffers.emplace_back(new buffer(capacity));
+        array.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    // owner only
+    void push(pool_task* t)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t tp = top.load(std::memory_order_acquire);
+        buffer* a = array.load(std::memory_order_relaxed);
+        if (b - tp > a->capacity - 1) a = grow(a, b, tp);
+        a->put(b, t);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, returns nullptr if the deque is empty
+    pool_task* pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        buffer* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        pool_task* res = nullptr;
+        if (t <= b)
+        {
+            res = a->get(b);
+            if (t == b)
+            {
+                // last element, races with stealers
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed))
+                    res = nullptr;
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+        {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    // any thread, returns nullptr if the deque is empty or the steal lost a race
+    pool_task* steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return nullptr;
+        buffer* a = array.load(std::memory_order_acquire);
+        pool_task* res = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return res;
+    }
+};
+
+// pool of worker threads with a work stealing deque per worker
+// tasks submitted from a worker go to its own deque, tasks submitted from other threads go to a
+// shared queue, idle workers steal from the others
+class thread_pool
+{
+    std::vector<std::unique_ptr<work_stealing_deque>> queues;
+    std::vector<std::thread> workers;
+
+    // tasks submitted from threads outside the pool
+    std::mutex shared_mutex;
+    std::deque<pool_task*> shared_queue;
+
+    // number of submitted tasks which were not taken yet, idle workers sleep while it is 0
+    std::atomic<size_t> pending;
+    std::atomic_bool stopping;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    // the pool and the index of the worker the current thread belongs to, if any
+    static thread_pool*& current_pool()
+    {
+        static thread_local thread_pool* pool = nullptr;
+        return pool;
+    }
+
+    static size_t& current_index()
+    {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    void push(pool_task* t)
+    {
+        if (current_pool() == this)
+        {
+            queues[current_index()]->push(t);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            shared_queue.push_back(t);
+        }
+        ++pending;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_one();
+    }
+
+    // looks for a task: own deque first, then the shared queue, then the other workers' deques
+    pool_task* take()
+    {
+        pool_task* res = nullptr;
+        size_t self_index = current_pool() == this ? current_index() : queues.size();
+
+        if (self_index < queues.size()) res = queues[self_index]->pop();
+        if (res == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            if (!shared_queue.empty())
+            {
+                res = shared_queue.front();
+                shared_queue.pop_front();
+            }
+        }
+        for (size_t i = 1; res == nullptr && i <= queues.size(); ++i)
+        {
+            size_t victim = (self_index + i) % queues.size();
+            if (victim != self_index) res = queues[victim]->steal();
+        }
+
+        if (res != nullptr) --pending;
+        return res;
+    }
+
+    static void run(pool_task* t)
+    {
+        std::unique_ptr<pool_task> owner(t);
+        (*t)();
+    }
+
+    void worker_loop(size_t index)
+    {
+        current_pool() = this;
+        current_index() = index;
+
+        while (true)
+        {
+            pool_task* t = take();
+            if (t != nullptr)
+            {
+                run(t);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this]() { return pending > 0 || stopping; });
+            if (stopping && pending == 0) break;
+        }
+    }
+
+    public:
+    // creates a pool of the given number of workers (at least 1)
+    explicit thread_pool(size_t threads = std::thread::hardware_concurrency())
+    : pending(0), stopping(false)
+    {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i)
+            queues.emplace_back(new work_stealing_deque());
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back(&thread_pool::worker_loop, this, i);
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // runs all the tasks which were already submitted and joins the workers
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    // returns the number of workers
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    // the pool shared by the library's parallel kernels, with a worker per hardware thread
+    static thread_pool& default_pool()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    // schedules f() and returns a future for its result
+    // a task which waits for another task's future should use get() to avoid starving the pool
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F&& f)
+    {
+        typedef typename std::result_of<F()>::type R;
+        auto job = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> res = job->get_future();
+        push(new pool_task([job]() { (*job)(); }));
+        return res;
+    }
+
+    // runs a single pending task in the calling thread
+    // returns false if there was no task to run
+    bool run_pending_task()
+    {
+        pool_task* t = take();
+        if (t == nullptr) return false;
+        run(t);
+        return true;
+    }
+
+    // waits for the result of a submitted task, running other pending tasks in the meantime
+    template <typename R>
+    R get(std::future<R>& f)
+    {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            if (!run_pending_task()) std::this_thread::yield();
+        return f.get();
+    }
+
+    // calls f(i) for every i in [begin, end), splitting the range into chunks run by the workers
+    // the calling thread runs chunks too, so it never blocks on workers busy with other tasks
+    // rethrows the first exception thrown by f, after all the chunks finished
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, const F& f)
+    {
+        if (begin >= end) return;
+
+        struct state
+        {
+            std::atomic<size_t> next_chunk{ 0 }, finished_chunks{ 0 };
+            std::mutex error_mutex;
+            std::exception_ptr error;
+        };
+
+        size_t chunks = std::min(end - begin, 4 * (size() + 1));
+        size_t chunk_size = (end - begin + chunks - 1) / chunks;
+        chunks = (end - begin + chunk_size - 1) / chunk_size;
+        auto shared_state = std::make_shared<state>();
+
+        // claims and runs chunks until there are none left
+        // the tasks may start after parallel_for returned, but then they claim no chunk and never
+        // touch f, while a claimed chunk is running parallel_for can't return
+        const F* pf = &f;
+        auto work = [shared_state, chunks, chunk_size, begin, end, pf]() {
+            for (size_t c; (c = shared_state->next_chunk++) < chunks;)
+            {
+                try
+                {
+                    for (size_t i = begin + c * chunk_size; i < std::min(begin + (c + 1) * chunk_size, end); ++i)
+                        (*pf)(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(shared_state->error_mutex);
+                    if (!shared_state->error) shared_state->error = std::current_exception();
+                }
+                ++shared_state->finished_chunks;
+            }
+        };
+
+        for (size_t i = 1; i < std::min(chunks, size() + 1); ++i)
+            push(new pool_task(work));
+        work();
+
+        // the chunks claimed by other threads may still be running, meanwhile the calling thread
+        // runs other pending tasks (e.g the nested parallel loops of the task it waits for)
+        while (shared_state->finished_chunks < chunks)
+            if (!run_pending_task()) std::this_thread::yield();
+        if (shared_state->error) std::rethrow_exception(shared_state->error);
+    }
+};
+
+} // namespace AlgebraTAU
+
+#endif
@@ -5,18 +5,21 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base.h"
+#include "storage.h"
 
 namespace AlgebraTAU
 {
 // generativeclass vector represents a vector of orientation O (row / column) and type T
-template <orientation O, typename T>
+// its storage is allocated by A
+template <orientation O, typename T, typename A>
 class vector
 {
     // stores the vector's data
-    std::vector<T> arr;
+    std::vector<T, typename storage_allocator<A>::type> arr;
 
     public:
     // constructs matrix of shape rows x columns with default value = a
@@ -26,8 +29,8 @@ class vector
     template <typename T2>
     vector(const std::initializer_list<T2>& _arr);
 
-    template <typename T2>
-    vector(const std::vector<T2>& _arr);
+    template <typename T2, typename A2>
+    vector(const std::vector<T2, A2>& _arr);
 
     // returns the size of the vector
     inline size_t size() const;
@@ -51,30 +54,40 @@ class vector
 
     // adds two vectores and returns the result
     // throws std::invalid_argument if vectores do not have same size
-    vector operator+(const vector& other) const;
+    // the overloads taking an rvalue reuse its storage for the result
+    vector operator+(const vector& other) const&;
+    vector operator+(const vector& other) &&;
+    vector operator+(vector&& other) const&;
+    vector operator+(vector&& other) &&;
     // adds vector "other" to "self" and returns reference to "self"
     // throws std::invalid_argument if vectors do not have same size
     // addition is done in-place
     vector& operator+=(const vector& other);
 
     // negates each element of the vector
-    vector operator-() const;
+    vector operator-() const&;
+    vector operator-() &&;
     // substracts two vectores and returns the result
     // throws std::invalid_argument if vectores do not have same size
-    vector operator-(const vector& other) const;
+    // the overloads taking an rvalue reuse its storage for the result
+    vector operator-(const vector& other) const&;
+    vector operator-(const vector& other) &&;
+    vector operator-(vector&& other) const&;
+    vector operator-(vector&& other) &&;
     // subtracts vector "other" from "self" and returns reference to "self"
     // throws std::invalid_argument if vectors do not have same size
     // addition is done in-place
     vector& operator-=(const vector& other);
 
     // preforms right scalar multiplication and returns the result
-    vector operator*(const T& a) const;
+    vector operator*(const T& a) const&;
+    vector operator*(const T& a) &&;
     // preforms in-place scalar multiplication, the result is stored in "self"
     // returns reference to self
     vector& operator*=(const T& a);
 
     // turns vector into vector of transposed shape
-    vector<orientation(!O), T> transpose() const;
+    vector<orientation(!O), T, A> transpose() const;
 
     // calculates the norm of the matrix - i.e dot(self,self)
     T norm() const;
@@ -86,25 +99,27 @@ class vector
 // preforms multiplication of  vec*mat (left matrix-vector multiplication)
 // returns the result as a row vector
 // throws std::invalid_argument if matrix and vector do not allow matrix-vector multiplication
-template <typename T>
-vector<row, T> operator*(const vector<row, T>& vec, const matrix<T>& mat);
+template <typename T, typename A>
+vector<row, T, A> operator*(const vector<row, T, A>& vec, const matrix<T, A>& mat);
 
 // preforms multiplication of  vec*mat (left matrix-vector multiplication)
 // stores result in self and returns reference to self
-template <typename T>
-vector<row, T> operator*=(vector<row, T>&, const matrix<T>& mat);
+template <typename T, typename A>
+vector<row, T, A> operator*=(vector<row, T, A>&, const matrix<T, A>& mat);
 
 // calculates the dot product of vectors a,b
-template <orientation O, typename T>
-T dot(const vector<O, T>& a, const vector<O, T>& b);
+template <orientation O, typename T, typename A>
+T dot(const vector<O, T, A>& a, const vector<O, T, A>& b);
 
 // calculates the projection of vector a on vector b
-template <orientation O, typename T>
-vector<O, T> project(const vector<O, T>& a, const vector<O, T>& b);
+template <orientation O, typename T, typename A>
+vector<O, T, A> project(const vector<O, T, A>& a, const vector<O, T, A>& b);
 
 // left scalar multiplication
-template <orientation O, typename T>
-vector<O, T> operator*(const T& b, const vector<O, T>& a);
+template <orientation O, typename T, typename A>
+vector<O, T, A> operator*(const T& b, const vector<O, T, A>& a);
+template <orientation O, typename T, typename A>
+vector<O, T, A> operator*(const T& b, vector<O, T, A>&& a);
 
 } // namespace AlgebraTAU
 
@@ -1,50 +1,63 @@
 #include "vector.h"
 namespace AlgebraTAU
 {
-template <orientation O, typename T>
+template <orientation O, typename T, typename A>
 template <typename F>
-void vector<O, T>::map(const F& f)
+void vector<O, T, A>::map(const F& f)
 {
     for (int i = 0; i < size(); ++i)
         self(i) = f(self(i));
 }
 
-template <orientation O, typename T>
-vector<orientation(!O), T> vector<O, T>::transpose() const
+template <orientation O, typename T, typename A>
+vector<orientation(!O), T, A> vector<O, T, A>::transpose() const
 {
-    return vector<orientation(!O), T>(arr);
+    return vector<orientation(!O), T, A>(arr);
 }
 
-template <orientation O, typename T>
-T vector<O, T>::norm() const
+template <orientation O, typename T, typename A>
+T vector<O, T, A>::norm() const
 {
     return dot(self, self);
 }
 
-template <orientation O, typename T>
-vector<O, T> operator*(const T& b, const vector<O, T>& a)
+template <orientation O, typename T, typename A>
+vector<O, T, A> operator*(const T& b, const vector<O, T, A>& a)
 {
     return a * b;
 }
 
-template <orientation O, typename T>
-vector<O, T>& vector<O, T>::operator*=(const T& a)
+template <orientation O, typename T, typename A>
+vector<O, T, A> operator*(const T& b, vector<O, T, A>&& a)
+{
+    return std::move(a) * b;
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A>& vector<O, T, A>::operator*=(const T& a)
 {
     for (int i = 0; i < size(); ++i)
         self(i) *= a;
     return self;
 }
 
-template <orientation O, typename T>
-vector<O, T> vector<O, T>::operator*(const T& a) const
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator*(const T& a) const&
 {
     auto res = self;
     res *= a;
     return res;
 }
 
-template <orientation O, typename T>
-vector<O, T>& vector<O, T>::operator+=(const vector<O, T>& other)
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator*(const T& a) &&
+{
+    self *= a;
+    return std::move(self);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A>& vector<O, T, A>::operator+=(const vector<O, T, A>& other)
 {
     if (size() != other.size()) throw std::invalid_argument("vectors must have same shapes");
     for (int i = 0; i < size(); ++i)
@@ -52,16 +65,37 @@ vector<O, T>& vector<O, T>::operator+=(const vector<O, T>& other)
     return self;
 }
 
-template <orientation O, typename T>
-vector<O, T> vector<O, T>::operator+(const vector<O, T>& other) const
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator+(const vector<O, T, A>& other) const&
 {
     auto res = self;
     res += other;
     return res;
 }
 
-template <orientation O, typename T>
-vector<O, T>& vector<O, T>::operator-=(const vector<O, T>& other)
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator+(const vector<O, T, A>& other) &&
+{
+    self += other;
+    return std::move(self);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator+(vector<O, T, A>&& other) const&
+{
+    other += self;
+    return std::move(other);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator+(vector<O, T, A>&& other) &&
+{
+    self += other;
+    return std::move(self);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A>& vector<O, T, A>::operator-=(const vector<O, T, A>& other)
 {
     if (size() != other.size()) throw std::invalid_argument("vectors must have same shapes");
     for (int i = 0; i < size(); ++i)
@@ -69,56 +103,85 @@ vector<O, T>& vector<O, T>::operator-=(const vector<O, T>& other)
     return self;
 }
 
-template <orientation O, typename T>
-vector<O, T> vector<O, T>::operator-(const vector<O, T>& other) const
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-(const vector<O, T, A>& other) const&
 {
     auto res = self;
     res -= other;
     return res;
 }
 
-template <orientation O, typename T>
-vector<O, T> vector<O, T>::operator-() const
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-(const vector<O, T, A>& other) &&
+{
+    self -= other;
+    return std::move(self);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-(vector<O, T, A>&& other) const&
+{
+    if (size() != other.size()) throw std::invalid_argument("vectors must have same shapes");
+    for (int i = 0; i < size(); ++i)
+        other(i) = self(i) - other(i);
+    return std::move(other);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-(vector<O, T, A>&& other) &&
+{
+    self -= other;
+    return std::move(self);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-() const&
 {
     auto res = self;
+    return -std::move(res);
+}
+
+template <orientation O, typename T, typename A>
+vector<O, T, A> vector<O, T, A>::operator-() &&
+{
     for (int i = 0; i < size(); ++i)
-        res(i) = -self(i);
-    return res;
+        self(i) = -self(i);
+    return std::move(self);
 }
 
-template <orientation O, typename T>
-size_t vector<O, T>::size() const
+template <orientation O, typename T, typename A>
+size_t vector<O, T, A>::size() const
 {
     return arr.size();
 }
 
-template <orientation O, typename T>
-const T& vector<O, T>::operator()(size_t i) const
+template <orientation O, typename T, typename A>
+const T& vector<O, T, A>::operator()(size_t i) const
 {
     return arr[i];
 }
 
-template <orientation O, typename T>
-T& vector<O, T>::operator()(size_t i)
+template <orientation O, typename T, typename A>
+T& vector<O, T, A>::operator()(size_t i)
 {
     return arr[i];
 }
 
-template <typename T>
-vector<row, T> operator*(const vector<row, T>& v, const matrix<T>& mat)
+template <typename T, typename A>
+vector<row, T, A> operator*(const vector<row, T, A>& v, const matrix<T, A>& mat)
 {
     if (v.size() != mat.rows())
         throw std::invalid_argument("matrix and vector dimensions doesn't agree");
 
-    vector<row, T> res(mat.columns(), 0);
+    vector<row, T, A> res(mat.columns(), 0);
     for (int i = 0; i < mat.rows(); ++i)
         for (int j = 0; j < mat.columns(); ++j)
             res(j) += v(i) * mat(i, j);
     return res;
 }
 
-template <typename T>
-vector<row, T>& operator*=(vector<row, T>& v, const matrix<T>& mat)
+template <typename T, typename A>
+vector<row, T, A>& operator*=(vector<row, T, A>& v, const matrix<T, A>& mat)
 {
     if (v.size() != mat.rows())
         throw std::invalid_argument("matrix and vector dimensions doesn't agree");
@@ -126,28 +189,28 @@ vector<row, T>& operator*=(vector<row, T>& v, const matrix<T>& mat)
     return v;
 }
 
-template <orientation O, typename T>
-vector<O, T>::vector(size_t size, const T& a) : arr(size, a)
+template <orientation O, typename T, typename A>
+vector<O, T, A>::vector(size_t size, const T& a) : arr(size, a)
 {
     if (size == 0) throw std::invalid_argument("can't create empty vectors");
 }
 
-template <orientation O, typename T>
+template <orientation O, typename T, typename A>
 template <typename T2>
-vector<O, T>::vector(const std::initializer_list<T2>& _arr) : arr(_arr.begin(), _arr.end())
+vector<O, T, A>::vector(const std::initializer_list<T2>& _arr) : arr(_arr.begin(), _arr.end())
 {
     if (size() == 0) throw std::invalid_argument("can't create empty vectors");
 }
 
-template <orientation O, typename T>
-template <typename T2>
-vector<O, T>::vector(const std::vector<T2>& _arr) : arr(_arr.begin(), _arr.end())
+template <orientation O, typename T, typename A>
+template <typename T2, typename A2>
+vector<O, T, A>::vector(const std::vector<T2, A2>& _arr) : arr(_arr.begin(), _arr.end())
 {
     if (size() == 0) throw std::invalid_argument("can't create empty vectors");
 }
 
-template <orientation O, typename T>
-T dot(const vector<O, T>& a, const vector<O, T>& b)
+template <orientation O, typename T, typename A>
+T dot(const vector<O, T, A>& a, const vector<O, T, A>& b)
 {
     if (a.size() != b.size()) throw std::invalid_argument("vectos must have same shapes");
     T res = 0;
@@ -156,14 +219,14 @@ T dot(const vector<O, T>& a, const vector<O, T>& b)
     return res;
 }
 
-template <orientation O, typename T>
-vector<O, T> project(const vector<O, T>& a, const vector<O, T>& b)
+template <orientation O, typename T, typename A>
+vector<O, T, A> project(const vector<O, T, A>& a, const vector<O, T, A>& b)
 {
     return (dot(a, b) / dot(b, b)) * b;
 }
 
-template <orientation O, typename T>
-bool vector<O, T>::operator==(const vector& other) const
+template <orientation O, typename T, typename A>
+bool vector<O, T, A>::operator==(const vector& other) const
 {
     if (size() != other.size()) return false;
     for (int i = 0; i < size(); ++i)
@@ -171,14 +234,14 @@ bool vector<O, T>::operator==(const vector& other) const
     return true;
 }
 
-template <orientation O, typename T>
-bool vector<O, T>::operator!=(const vector<O, T>& other) const
+template <orientation O, typename T, typename A>
+bool vector<O, T, A>::operator!=(const vector<O, T, A>& other) const
 {
     return !(self == other);
 }
 
-template <orientation O, typename T>
-std::ostream& operator<<(std::ostream& out, const vector<O, T>& v)
+template <orientation O, typename T, typename A>
+std::ostream& operator<<(std::ostream& out, const vector<O, T, A>& v)
 {
     using AlgebraTAU::to_string;
     using std::to_string;